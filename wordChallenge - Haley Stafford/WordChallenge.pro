@@ -70,15 +70,35 @@ DEFINES     +=  main=qMain qMain=studentMain
 # Afterward we glob-add files to SOURCES ourselves. Operator *= will unique
 # entries, so no worries about duplicates
 SOURCES         *=  "" \
-    wordChallenge.cpp
+    batchsolver.cpp \
+    boardcache.cpp \
+    boardfilter.cpp \
+    boardsolver.cpp \
+    solverbenchmark.cpp \
+    wordChallenge.cpp \
+    wordsink.cpp \
+    wordtrie.cpp \
+    workstealingpool.cpp
 HEADERS         *=  "" \
-    testing/lettertile.h
+    batchsolver.h \
+    boardcache.h \
+    boardfilter.h \
+    boardsolver.h \
+    solverbenchmark.h \
+    testing/lettertile.h \
+    wordsink.h \
+    wordtrie.h \
+    workstealingpool.h
 
 # Gather any .cpp or .h files within the project folder (student/starter code).
 # Second argument true makes search recursive
 SOURCES         *=  $$files(*.cpp, true)
 HEADERS         *=  $$files(*.h, true)
 
+# Build tools under tools/ have their own main() and are not part of the program
+SOURCES         -=  $$files(tools/*.cpp, true)
+OTHER_FILES     *=  $$files(tools/*.cpp, true)
+
 # Gather resource files (image/sound/etc) from res dir, list under "Other files"
 OTHER_FILES     *=  $$files(res/*, true)
 # Gather text files from root dir or anywhere recursively
@@ -117,6 +137,43 @@ QMAKE_CXXFLAGS_WARN_ON      +=  -Wno-unused-const-variable
     QMAKE_CXXFLAGS_WARN_ON  +=  -Wlogical-op
 }
 
+# Run qmake with CONFIG+=solver_stats to build the solver with its search
+# counters (see SolverStats in boardsolver.h). They are compiled out otherwise.
+solver_stats {
+    DEFINES     +=  SOLVER_STATS
+}
+
+# Run qmake with CONFIG+=profile_allocations to have SimpleTest count every
+# allocation in the program (see MemoryDiagnostics.h). This replaces the global
+# operator new and delete, so it is left out of ordinary builds.
+profile_allocations {
+    DEFINES     +=  SIMPLETEST_PROFILE_ALLOCATIONS
+}
+
+###############################################################################
+#       Compile the dictionary into a binary trie image                       #
+###############################################################################
+
+# EnglishWords.txt is compiled into EnglishWords.trie, a flat pointer-free trie
+# that loadWordTrie() maps read-only at startup instead of parsing the word list.
+# The compiler is a small standalone tool built from tools/compiledictionary.cpp
+# and wordtrie.cpp with the host compiler; it reruns whenever the word list or
+# the trie code changes.
+DICTIONARY_TOOL     =   $$OUT_PWD/compiledictionary
+compile_dictionary.target   =  $$PWD/EnglishWords.trie
+compile_dictionary.depends  =  $$PWD/EnglishWords.txt $$PWD/tools/compiledictionary.cpp \
+                               $$PWD/wordtrie.cpp $$PWD/wordtrie.h
+compile_dictionary.commands =  $$QMAKE_CXX -std=c++11 -O2 -DWORDTRIE_NO_TESTS \
+                                   -I$$shell_quote($$PWD) \
+                                   $$shell_quote($$PWD/tools/compiledictionary.cpp) \
+                                   $$shell_quote($$PWD/wordtrie.cpp) \
+                                   -o $$shell_quote($$DICTIONARY_TOOL) && \
+                               $$shell_quote($$DICTIONARY_TOOL) \
+                                   $$shell_quote($$PWD/EnglishWords.txt) \
+                                   $$shell_quote($$PWD/EnglishWords.trie)
+QMAKE_EXTRA_TARGETS +=  compile_dictionary
+PRE_TARGETDEPS       +=  $${compile_dictionary.target}
+
 ###############################################################################
 #       Detect/report errors in project structure                             #
 ###############################################################################
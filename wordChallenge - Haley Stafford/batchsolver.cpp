@@ -0,0 +1,240 @@
+#include "batchsolver.h"
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include "error.h"
+#include "workstealingpool.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+bool parseBoardLine(const string& line, TileBoard& board, string& problem){
+    istringstream tokens(line);
+    string rings[3];
+    string extra;
+    if (!(tokens >> rings[0] >> rings[1] >> rings[2]) || (tokens >> extra)){
+        problem = "expected three rings (outer middle inner), use - for an empty ring";
+        return false;
+    }
+    const size_t RING_SIZES[3] = {16, 8, 1};
+    for (int i = 0; i < 3; i++){
+        if (rings[i] == "-") rings[i] = "";
+        if (rings[i].length() > RING_SIZES[i]){
+            problem = "ring " + to_string(i + 1) + " holds more than " + to_string(RING_SIZES[i]) + " tile(s)";
+            return false;
+        }
+    }
+    try {
+        board = makeRingBoard(rings[0], rings[1], rings[2]);
+    } catch (const ErrorException& e) {
+        problem = e.getMessage();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Type representing one board read from the input, and later its result line.
+ */
+struct BatchEntry {
+    int lineNumber;
+    bool valid;
+    TileBoard board;
+    string result;   /// the output line, without its line number
+};
+
+/** Boards the batch mode cache holds at once. */
+static const size_t BATCH_CACHE_CAPACITY = 65536;
+
+/** The solveEntry() function solves one board, or looks it up in 'cache',
+ * and formats its result line. The solver sends each word once, so the words
+ * are gathered in a vector and sorted instead of being inserted into a Set one
+ * at a time.
+ */
+static void solveEntry(BatchEntry& entry, const WordTrie& trie, const SolverOptions& options,
+                       BoardResultCache* cache){
+    if (!entry.valid) return;
+    BoardResultCache::Words cached;
+    vector<string> solved;
+    if (cache != nullptr){
+        cached = cache->words(entry.board, options);
+    } else {
+        VectorSink sink(solved);
+        solveBoard(entry.board, trie, sink, options);
+        sort(solved.begin(), solved.end());
+    }
+    const vector<string>& validWords = cached ? *cached : solved;
+    ostringstream line;
+    line << validWords.size() << '\t';
+    bool first = true;
+    for (const string& word: validWords){
+        if (!first) line << ' ';
+        line << word;
+        first = false;
+    }
+    entry.result = line.str();
+}
+
+/** The solveChunk() function solves a chunk of boards, in parallel across
+ * boards when there is more than one worker, and writes the results in order.
+ */
+static void solveChunk(vector<BatchEntry>& chunk, ostream& out, const WordTrie& trie,
+                       const SolverOptions& options, BoardResultCache* cache){
+    SolverOptions perBoard = options;
+    if (workerCount(options.threads) > 1 && chunk.size() > 1){
+        perBoard.threads = 1;
+        vector<WorkStealingPool::Task> tasks;
+        for (BatchEntry& entry: chunk){
+            BatchEntry* target = &entry;
+            tasks.push_back([target, &trie, &perBoard, cache](int){ solveEntry(*target, trie, perBoard, cache); });
+        }
+        sharedPool(options.threads).runAll(tasks);
+    } else {
+        for (BatchEntry& entry: chunk){
+            solveEntry(entry, trie, perBoard, cache);
+        }
+    }
+    for (const BatchEntry& entry: chunk){
+        out << entry.lineNumber << '\t' << entry.result << '\n';
+    }
+    out.flush();
+}
+
+int solveBoardStream(istream& in, ostream& out, const WordTrie& trie, const SolverOptions& options,
+                     BoardResultCache* cache){
+    const size_t CHUNK_SIZE = 256;
+    vector<BatchEntry> chunk;
+    int lineNumber = 0;
+    int solved = 0;
+    string line;
+    while (getline(in, line)){
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#') continue;
+        BatchEntry entry;
+        entry.lineNumber = lineNumber;
+        string problem;
+        entry.valid = parseBoardLine(line, entry.board, problem);
+        if (entry.valid){
+            solved++;
+        } else {
+            entry.result = "error\t" + problem;
+        }
+        chunk.push_back(entry);
+        if (chunk.size() == CHUNK_SIZE){
+            solveChunk(chunk, out, trie, options, cache);
+            chunk.clear();
+        }
+    }
+    solveChunk(chunk, out, trie, options, cache);
+    return solved;
+}
+
+/** The processStreamPath() function returns a path that opens the process's own
+ * standard input (descriptor 0) or output (descriptor 1), or the empty string if
+ * the platform has none. Batch mode cannot use cin and cout, which the console
+ * library hands to its window rather than to the process's descriptors.
+ */
+static string processStreamPath(int descriptor){
+#ifdef _WIN32
+    (void) descriptor;
+    return "";
+#else
+    return "/dev/fd/" + to_string(descriptor);
+#endif
+}
+
+bool runBatchModeIfRequested(){
+    const char* inputPath = getenv("WORDCHALLENGE_BATCH");
+    if (inputPath == nullptr || *inputPath == '\0') return false;
+
+    SolverOptions options;
+    if (const char* threads = getenv("WORDCHALLENGE_THREADS")){
+        options.threads = atoi(threads);
+    }
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+
+    string inputName = inputPath;
+    if (inputName == "-"){
+        inputName = processStreamPath(0);
+        if (inputName.empty()){
+            cerr << "Batch mode: name a file in WORDCHALLENGE_BATCH, standard input is not supported here" << endl;
+            return true;
+        }
+    }
+    ifstream in(inputName);
+    if (!in){
+        cerr << "Batch mode: cannot read " << inputName << endl;
+        return true;
+    }
+
+    const char* outputPath = getenv("WORDCHALLENGE_BATCH_OUTPUT");
+    string outputName = (outputPath != nullptr) ? outputPath : "";
+    ios::openmode mode = ios::out | ios::trunc;
+    if (outputName.empty()){
+        outputName = processStreamPath(1);
+        mode = ios::out | ios::app;   // leave alone what the shell already wrote with >>
+        if (outputName.empty()){
+            cerr << "Batch mode: name a file in WORDCHALLENGE_BATCH_OUTPUT, standard output is not supported here" << endl;
+            return true;
+        }
+    }
+    ofstream out(outputName, mode);
+    if (!out){
+        cerr << "Batch mode: cannot write " << outputName << endl;
+        return true;
+    }
+
+    BoardResultCache cache(trie, BATCH_CACHE_CAPACITY);
+    const char* cachePath = getenv("WORDCHALLENGE_CACHE");
+    bool persistent = cachePath != nullptr && *cachePath != '\0';
+    if (persistent){
+        cache.load(cachePath);
+    }
+    int solved = solveBoardStream(in, out, trie, options, &cache);
+    if (persistent && !cache.save(cachePath)){
+        cerr << "Batch mode: cannot write " << cachePath << endl;
+    }
+    cerr << "Batch mode: solved " << solved << " boards, " << cache.hits() << " from the cache" << endl;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("parseBoardLine accepts three rings and rejects malformed lines"){
+    TileBoard board;
+    string problem;
+    EXPECT(parseBoardLine("POR WE R", board, problem));
+    EXPECT_EQUAL(board.numTiles, 6);
+    EXPECT_EQUAL(board.tiles[3].letter, 'w');
+    EXPECT_EQUAL(int(board.tiles[3].depth), 2);
+    EXPECT(parseBoardLine("  MOOO\t-  N ", board, problem));
+    EXPECT_EQUAL(board.numTiles, 5);
+    EXPECT(!parseBoardLine("MOOO N", board, problem));
+    EXPECT(!parseBoardLine("MOOO - N X", board, problem));
+    EXPECT(!parseBoardLine("MO2O - N", board, problem));
+    EXPECT(!parseBoardLine("abcdefghijklmnopq - n", board, problem));
+    EXPECT(!parseBoardLine("a - nn", board, problem));
+}
+
+STUDENT_TEST("solveBoardStream writes one line per board in input order"){
+    WordTrie trie({"moon", "pore", "power", "prow", "prower", "rope", "roper", "rower"});
+    for (int threads: {1, 3}){
+        SolverOptions options;
+        options.threads = threads;
+        for (bool cached: {false, true}){
+            BoardResultCache cache(trie, 16);
+            istringstream in("# boards\nPOR WE R\n\nMOOO - N\nnot a real board\nPOR WE RR\nROP EW R\n");
+            ostringstream out;
+            EXPECT_EQUAL(solveBoardStream(in, out, trie, options, cached ? &cache : nullptr), 3);
+            EXPECT_EQUAL(out.str(), "2\t7\tpore power prow prower rope roper rower\n"
+                                    "4\t1\tmoon\n"
+                                    "5\terror\texpected three rings (outer middle inner), use - for an empty ring\n"
+                                    "6\terror\tring 3 holds more than 1 tile(s)\n"
+                                    "7\t7\tpore power prow prower rope roper rower\n");
+        }
+    }
+}
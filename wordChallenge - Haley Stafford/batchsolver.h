@@ -0,0 +1,59 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include "boardcache.h"
+#include "boardsolver.h"
+#include "wordtrie.h"
+
+/* * * * * * BATCH SOLVER * * * * * */
+
+/**
+ * Batch mode solves many boards without any prompts. Each input line holds one
+ * board as its outer, middle and inner ring letters separated by whitespace,
+ * with "-" standing for an empty ring:
+ *
+ *     zqwrtuopjikqezxv ugztyeio t
+ *     POR WE R
+ *     MOOO - N
+ *
+ * Blank lines and lines starting with '#' are skipped. For every board, one
+ * line is written as soon as its chunk of boards is solved, holding the input
+ * line number, the number of words, and the words in alphabetical order, all
+ * separated by tabs and spaces like so:
+ *
+ *     2<TAB>7<TAB>pore power prow prower rope roper rower
+ *
+ * A line that is not a valid board produces "<line><TAB>error<TAB><reason>".
+ */
+
+/**
+ * Given one line of batch input, fills in 'board' and returns true, or fills in
+ * 'problem' and returns false if the line is not a valid board.
+ */
+bool parseBoardLine(const std::string& line, TileBoard& board, std::string& problem);
+
+/**
+ * Reads boards from 'in' until it runs out, solves each against 'trie' and
+ * writes the results to 'out'. Boards are read and solved in chunks; when
+ * options.threads allows more than one worker, the boards of a chunk are solved
+ * side by side, each on a single thread, and written back in input order.
+ * If 'cache' is given, boards are looked up in it first and only the ones it
+ * does not hold are solved. Returns the number of boards solved.
+ */
+int solveBoardStream(std::istream& in, std::ostream& out, const WordTrie& trie,
+                     const SolverOptions& options = SolverOptions(),
+                     BoardResultCache* cache = nullptr);
+
+/**
+ * Runs batch mode if the WORDCHALLENGE_BATCH environment variable is set,
+ * reading boards from the file it names, or from standard input if it is "-".
+ * Results go to the file named by WORDCHALLENGE_BATCH_OUTPUT, or to standard
+ * output. Standard input and output here mean the process's own, so batch mode
+ * works in a pipe; cin and cout belong to the console window. On Windows they
+ * cannot be reached that way, and both variables must name real files.
+ * WORDCHALLENGE_THREADS sets the number of worker threads (0 means
+ * one per core). Repeated boards are answered from a BoardResultCache, which is
+ * loaded from and saved back to the file named by WORDCHALLENGE_CACHE if it is
+ * set. Returns whether batch mode ran.
+ */
+bool runBatchModeIfRequested();
@@ -0,0 +1,246 @@
+#include "boardcache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "boardfilter.h"
+#include "testing/SimpleTest.h"
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+/** First line of a saved cache, followed by the dictionary hash in hex. */
+static const string CACHE_FILE_MAGIC = "WCBOARDCACHE 1";
+
+/** The fnv1a() function returns the 64-bit FNV-1a hash of 'text', continuing
+ * from 'hash'.
+ */
+static uint64_t fnv1a(const string& text, uint64_t hash = 14695981039346656037ULL){
+    for (unsigned char ch: text){
+        hash = (hash ^ ch) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/** The canonicalBoard() function sorts the tiles by depth and then by letter,
+ * dropping their uniqueIDs, and writes each depth's letters after the depth.
+ */
+string canonicalBoard(const TileBoard& board){
+    vector<pair<int, char>> tiles;
+    for (int i = 0; i < board.numTiles; i++){
+        tiles.push_back(make_pair(int(board.tiles[i].depth), board.tiles[i].letter));
+    }
+    sort(tiles.begin(), tiles.end());
+    string canonical;
+    for (size_t i = 0; i < tiles.size(); i++){
+        if (i == 0 || tiles[i].first != tiles[i - 1].first){
+            if (i > 0) canonical += ' ';
+            canonical += to_string(tiles[i].first);
+        }
+        canonical += tiles[i].second;
+    }
+    return canonical;
+}
+
+uint64_t canonicalBoardKey(const TileBoard& board){
+    return fnv1a(canonicalBoard(board));
+}
+
+/** The dictionaryHash() function hashes the sorted playable words of the
+ * trie's SignatureIndex, which are the only words a solve can return.
+ */
+uint64_t dictionaryHash(const WordTrie& trie){
+    uint64_t hash = fnv1a("");
+    for (const string& word: trie.signatureIndex().words){
+        hash = fnv1a(word + '\n', hash);
+    }
+    return hash;
+}
+
+BoardResultCache::BoardResultCache(const WordTrie& trie, size_t capacity)
+    : trie(trie), dictionary(dictionaryHash(trie)), capacity(max(capacity, size_t(1))) {}
+
+/** The find() function returns the cached words of a board and marks it most
+ * recently used, or returns nullptr. The caller holds the lock.
+ */
+BoardResultCache::Words BoardResultCache::find(uint64_t key, const string& canonical){
+    auto found = index.find(key);
+    if (found == index.end() || found->second->canonical != canonical) return nullptr;
+    recent.splice(recent.begin(), recent, found->second);
+    return found->second->words;
+}
+
+/** The insert() function caches the words of a board as most recently used,
+ * dropping the least recently used board if the cache is full. The caller
+ * holds the lock.
+ */
+void BoardResultCache::insert(uint64_t key, const string& canonical, Words words){
+    auto found = index.find(key);
+    if (found != index.end()){
+        recent.erase(found->second);
+        index.erase(found);
+    }
+    recent.push_front(Entry{key, canonical, move(words)});
+    index[key] = recent.begin();
+    if (recent.size() > capacity){
+        index.erase(recent.back().key);
+        recent.pop_back();
+    }
+}
+
+/** The words() function solves outside the lock, so threads missing on
+ * different boards solve side by side. Two threads missing on the same board
+ * both solve it, and the second result replaces the first.
+ */
+BoardResultCache::Words BoardResultCache::words(const TileBoard& board, const SolverOptions& options){
+    string canonical = canonicalBoard(board);
+    uint64_t key = fnv1a(canonical);
+    {
+        lock_guard<mutex> guard(lock);
+        Words cached = find(key, canonical);
+        if (cached){
+            hitCount++;
+            return cached;
+        }
+        missCount++;
+    }
+    shared_ptr<vector<string>> solved = make_shared<vector<string>>();
+    VectorSink sink(*solved);
+    solveBoard(board, trie, sink, options);
+    sort(solved->begin(), solved->end());
+    lock_guard<mutex> guard(lock);
+    insert(key, canonical, solved);
+    return solved;
+}
+
+/** The save() function writes the boards from least to most recently used,
+ * one per line as the canonical form, a tab and the words separated by spaces,
+ * so loading them back in order restores the same order of use. Like
+ * WordTrie::saveImage(), it writes to a temporary name and renames it over
+ * 'path', so a crash never leaves a truncated cache behind. The temporary name
+ * carries the process id, so batch runs saving the same cache at once each
+ * write a whole file and the last rename wins.
+ */
+bool BoardResultCache::save(const string& path) const {
+    string partial = path + ".partial." + to_string(getpid());
+    ofstream out(partial.c_str(), ios::trunc);
+    if (!out) return false;
+    char tag[17];
+    snprintf(tag, sizeof(tag), "%016llx", (unsigned long long) dictionary);
+    out << CACHE_FILE_MAGIC << ' ' << tag << '\n';
+    lock_guard<mutex> guard(lock);
+    for (auto entry = recent.rbegin(); entry != recent.rend(); ++entry){
+        out << entry->canonical << '\t';
+        for (size_t i = 0; i < entry->words->size(); i++){
+            if (i > 0) out << ' ';
+            out << (*entry->words)[i];
+        }
+        out << '\n';
+    }
+    out.close();
+    if (!out){
+        remove(partial.c_str());
+        return false;
+    }
+    return rename(partial.c_str(), path.c_str()) == 0;
+}
+
+int BoardResultCache::load(const string& path){
+    ifstream in(path);
+    string line;
+    if (!getline(in, line)) return 0;
+    istringstream header(line);
+    string magic, version, tag;
+    header >> magic >> version >> tag;
+    if (magic + ' ' + version != CACHE_FILE_MAGIC || tag.empty()
+            || strtoull(tag.c_str(), nullptr, 16) != dictionary){
+        return 0;
+    }
+    int loaded = 0;
+    lock_guard<mutex> guard(lock);
+    while (getline(in, line)){
+        size_t tab = line.find('\t');
+        if (tab == string::npos) continue;
+        string canonical = line.substr(0, tab);
+        shared_ptr<vector<string>> words = make_shared<vector<string>>();
+        istringstream wordList(line.substr(tab + 1));
+        string word;
+        while (wordList >> word){
+            words->push_back(word);
+        }
+        insert(fnv1a(canonical), canonical, words);
+        loaded++;
+    }
+    return loaded;
+}
+
+size_t BoardResultCache::size() const {
+    lock_guard<mutex> guard(lock);
+    return recent.size();
+}
+
+long long BoardResultCache::hits() const {
+    lock_guard<mutex> guard(lock);
+    return hitCount;
+}
+
+long long BoardResultCache::misses() const {
+    lock_guard<mutex> guard(lock);
+    return missCount;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("Boards with the same letters at each depth share a canonical form"){
+    TileBoard board = makeRingBoard("POR", "WE", "R");
+    EXPECT_EQUAL(canonicalBoard(board), "1opr 2ew 3r");
+    EXPECT_EQUAL(canonicalBoardKey(makeRingBoard("ROP", "EW", "R")), canonicalBoardKey(board));
+    EXPECT(canonicalBoardKey(makeRingBoard("POR", "WR", "E")) != canonicalBoardKey(board));
+    EXPECT_EQUAL(canonicalBoard(makeRingBoard("MOOO", "", "N")), "1mooo 3n");
+}
+
+STUDENT_TEST("BoardResultCache hits on reordered boards and drops the least recently used"){
+    WordTrie trie({"moon", "pore", "power", "prow", "prower", "rope", "roper", "rower"});
+    BoardResultCache cache(trie, 2);
+    BoardResultCache::Words words = cache.words(makeRingBoard("POR", "WE", "R"));
+    EXPECT(*words == vector<string>({"pore", "power", "prow", "prower", "rope", "roper", "rower"}));
+    EXPECT(cache.words(makeRingBoard("RPO", "EW", "R")) == words);   // the same cached result
+    cache.words(makeRingBoard("MOOO", "", "N"));
+    cache.words(makeRingBoard("POR", "WE", "R"));
+    cache.words(makeRingBoard("ABC", "D", "E"));   // drops MOOO
+    EXPECT_EQUAL(cache.size(), 2u);
+    EXPECT_EQUAL(cache.hits(), 2);
+    cache.words(makeRingBoard("OOOM", "", "N"));
+    EXPECT_EQUAL(cache.misses(), 4);
+}
+
+STUDENT_TEST("BoardResultCache saves and loads, ignoring files for other dictionaries"){
+    WordTrie trie({"moon", "pore", "power", "prow", "rope"});
+    string path = "boardcache-test.cache";
+    BoardResultCache cache(trie, 8);
+    cache.words(makeRingBoard("POR", "WE", "R"));
+    cache.words(makeRingBoard("MOOO", "", "N"));
+    cache.words(makeRingBoard("XYZ", "", ""));
+    EXPECT(cache.save(path));
+    EXPECT(cache.save(path));   // saving again replaces the file
+    EXPECT(!cache.save("no-such-directory/" + path));
+
+    BoardResultCache reloaded(trie, 8);
+    EXPECT_EQUAL(reloaded.load(path), 3);
+    EXPECT(*reloaded.words(makeRingBoard("ROP", "EW", "R")) == vector<string>({"pore", "power", "prow", "rope"}));
+    EXPECT(reloaded.words(makeRingBoard("ZYX", "", ""))->empty());
+    EXPECT_EQUAL(reloaded.misses(), 0);
+
+    WordTrie otherTrie({"moon", "noon"});
+    BoardResultCache other(otherTrie, 8);
+    EXPECT_EQUAL(other.load(path), 0);
+    EXPECT_EQUAL(other.load("no-such-file.cache"), 0);
+    remove(path.c_str());
+}
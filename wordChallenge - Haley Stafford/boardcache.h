@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "boardsolver.h"
+#include "wordtrie.h"
+
+/* * * * * * BOARD RESULT CACHE * * * * * */
+
+/**
+ * Given a TileBoard, returns its canonical form: the letters of each depth in
+ * sorted order, one group per depth from the outermost in, like "1mooot 2noot 3o".
+ * Which words a board spells depends only on the letters at each depth, so two
+ * boards whose rings hold the same letters in any order have the same canonical
+ * form and the same words.
+ */
+std::string canonicalBoard(const TileBoard& board);
+
+/**
+ * Returns the 64-bit hash of the canonical form of 'board'.
+ */
+uint64_t canonicalBoardKey(const TileBoard& board);
+
+/**
+ * Returns a 64-bit hash of the playable words of 'trie', which tags cached
+ * results with the dictionary they were solved against.
+ */
+uint64_t dictionaryHash(const WordTrie& trie);
+
+/**
+ * Type representing a bounded cache of solved boards for one dictionary. A
+ * board is looked up by its canonical form, so a board seen before with its
+ * tiles in another order is a hit. When the cache is full, the least recently
+ * used board is dropped. The cache can be saved to a file and loaded back by a
+ * later run; the file records the dictionary hash, and a file saved for another
+ * dictionary is ignored.
+ *
+ * The cache may be shared by several threads.
+ *
+ * Ex) BoardResultCache cache(trie, 4096);
+ *     cache.load("boards.cache");
+ *     for (const string& word: *cache.words(board)) ...
+ */
+class BoardResultCache {
+public:
+    typedef std::shared_ptr<const std::vector<std::string>> Words;
+
+    BoardResultCache(const WordTrie& trie, std::size_t capacity);
+
+    /** Returns the words of 'board' in alphabetical order, solving the board
+     * with 'options' only if it is not in the cache.
+     */
+    Words words(const TileBoard& board, const SolverOptions& options = SolverOptions());
+
+    /** Writes every cached board to 'path'. Returns false if the file could
+     * not be written.
+     */
+    bool save(const std::string& path) const;
+
+    /** Adds the boards saved at 'path' to the cache and returns how many there
+     * were, or 0 if the file is missing or was saved for another dictionary.
+     */
+    int load(const std::string& path);
+
+    /** Number of boards cached, and of lookups that hit and missed so far. */
+    std::size_t size() const;
+    long long hits() const;
+    long long misses() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::string canonical;   // checked on lookup, so a hash collision is a miss
+        Words words;
+    };
+
+    Words find(uint64_t key, const std::string& canonical);
+    void insert(uint64_t key, const std::string& canonical, Words words);
+
+    const WordTrie& trie;
+    uint64_t dictionary;
+    std::size_t capacity;
+    mutable std::mutex lock;
+    std::list<Entry> recent;   // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    long long hitCount = 0;
+    long long missCount = 0;
+};
@@ -0,0 +1,276 @@
+#include "boardfilter.h"
+#include <algorithm>
+#include <cstring>
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/** The addLetter() function bumps the lane of 'letter' in 'counts'. */
+static void addLetter(LetterCounts& counts, char letter){
+    unsigned index = unsigned(letter - 'a');
+    if (index < 26){
+        counts.lanes[index / 8] += uint64_t(1) << (8 * (index % 8));
+    }
+}
+
+LetterCounts countLetters(const string& word){
+    LetterCounts counts;
+    memset(&counts, 0, sizeof(counts));
+    for (char letter: word){
+        addLetter(counts, letter);
+    }
+    return counts;
+}
+
+LetterCounts countLetters(const TileBoard& board){
+    LetterCounts counts;
+    memset(&counts, 0, sizeof(counts));
+    for (int i = 0; i < board.numTiles; i++){
+        addLetter(counts, board.tiles[i].letter);
+    }
+    return counts;
+}
+
+uint32_t letterMask(const string& word){
+    uint32_t mask = 0;
+    for (char letter: word){
+        unsigned index = unsigned(letter - 'a');
+        if (index < 26) mask |= uint32_t(1) << index;
+    }
+    return mask;
+}
+
+uint32_t letterMask(const TileBoard& board){
+    uint32_t mask = 0;
+    for (int i = 0; i < board.numTiles; i++){
+        unsigned index = unsigned(board.tiles[i].letter - 'a');
+        if (index < 26) mask |= uint32_t(1) << index;
+    }
+    return mask;
+}
+
+/** The collectWords() function walks the trie below 'node' in letter order,
+ * so the words come out sorted, adding each word of a playable length to the
+ * index.
+ */
+static void collectWords(const WordTrie& trie, uint32_t node, string& prefix, SignatureIndex& index){
+    if (prefix.length() >= size_t(MIN_WORD_LENGTH) && trie.isWord(node)){
+        index.words.push_back(prefix);
+        index.masks.push_back(letterMask(prefix));
+        index.counts.push_back(countLetters(prefix));
+    }
+    if (prefix.length() >= size_t(MAX_WORD_LENGTH)) return;
+    for (uint32_t letters = trie.childLetters(node); letters != 0; letters &= letters - 1){
+        char letter = char('a' + __builtin_ctz(letters));
+        prefix.push_back(letter);
+        collectWords(trie, trie.child(node, letter), prefix, index);
+        prefix.pop_back();
+    }
+}
+
+SignatureIndex buildSignatureIndex(const WordTrie& trie){
+    SignatureIndex index;
+    if (trie.nodeCount() > 0){
+        string prefix;
+        collectWords(trie, trie.root(), prefix, index);
+    }
+    return index;
+}
+
+/** The signatureIndex() function builds the index under the trie's once_flag,
+ * so threads asking at the same time wait for a single build.
+ */
+const SignatureIndex& WordTrie::signatureIndex() const {
+    call_once(signatures->built, [this](){
+        signatures->index = make_shared<const SignatureIndex>(buildSignatureIndex(*this));
+    });
+    return *signatures->index;
+}
+
+/** The wordsFittingBoard() function first rejects any word using a letter the
+ * board lacks, which is a single AND and discards nearly every word, and only
+ * then compares letter counts.
+ */
+vector<string> wordsFittingBoard(const TileBoard& board, const SignatureIndex& index){
+    vector<string> fitting;
+    uint32_t missingLetters = ~letterMask(board);
+    LetterCounts boardCounts = countLetters(board);
+    for (size_t i = 0; i < index.words.size(); i++){
+        if ((index.masks[i] & missingLetters) == 0 && fitsWithin(index.counts[i], boardCounts)){
+            fitting.push_back(index.words[i]);
+        }
+    }
+    return fitting;
+}
+
+WordTrie prefilterDictionary(const TileBoard& board, const SignatureIndex& index){
+    return WordTrie::fromSortedWords(wordsFittingBoard(board, index));
+}
+
+/** The countLettersByDepth() function numbers the distinct depths of the board
+ * in increasing order and counts the letters at each.
+ */
+DepthLetterCounts countLettersByDepth(const TileBoard& board){
+    int depths[MAX_TILES];
+    int numDepths = 0;
+    for (int i = 0; i < board.numTiles; i++){
+        depths[numDepths++] = board.tiles[i].depth;
+    }
+    sort(depths, depths + numDepths);
+    numDepths = int(unique(depths, depths + numDepths) - depths);
+
+    DepthLetterCounts counts;
+    memset(&counts, 0, sizeof(counts));
+    counts.numDepths = numDepths;
+    for (int i = 0; i < board.numTiles; i++){
+        unsigned letter = unsigned(board.tiles[i].letter - 'a');
+        if (letter >= 26) continue;
+        int depth = int(lower_bound(depths, depths + numDepths, int(board.tiles[i].depth)) - depths);
+        counts.counts[depth][letter]++;
+    }
+    return counts;
+}
+
+/** The spellsWithDepthRule() function gives each letter the shallowest free
+ * tile no shallower than the previous letter's. Taking a deeper tile instead
+ * would only raise the depth every later letter must reach, and later letters
+ * can never use the shallower tile once the depth has passed it, so if this
+ * greedy choice fails, every choice fails.
+ */
+bool spellsWithDepthRule(const string& word, const DepthLetterCounts& board){
+    int chosenDepth[MAX_WORD_LENGTH];
+    int depth = 0;
+    for (size_t i = 0; i < word.length(); i++){
+        unsigned letter = unsigned(word[i] - 'a');
+        if (letter >= 26 || i >= size_t(MAX_WORD_LENGTH)) return false;
+        for (; depth < board.numDepths; depth++){
+            int taken = 0;
+            for (size_t j = 0; j < i; j++){
+                if (word[j] == word[i] && chosenDepth[j] == depth) taken++;
+            }
+            if (board.counts[depth][letter] > taken) break;
+        }
+        if (depth == board.numDepths) return false;
+        chosenDepth[i] = depth;
+    }
+    return true;
+}
+
+void scanDictionary(const TileBoard& board, const SignatureIndex& index, WordSink& sink){
+    SolverStats stats;
+    scanDictionary(board, index, 0, index.words.size(), sink, stats);
+}
+
+/** The scanDictionary() function makes the signature pass over the whole range
+ * before handing any word to the sink, so the tight loop over the signatures
+ * never calls out of this file.
+ */
+void scanDictionary(const TileBoard& board, const SignatureIndex& index, size_t begin,
+                    size_t end, WordSink& sink, SolverStats& stats){
+    uint32_t missingLetters = ~letterMask(board);
+    LetterCounts boardCounts = countLetters(board);
+    vector<uint32_t> fitting;
+    for (size_t i = begin; i < end; i++){
+        if ((index.masks[i] & missingLetters) == 0 && fitsWithin(index.counts[i], boardCounts)){
+            fitting.push_back(uint32_t(i));
+        }
+    }
+    DepthLetterCounts depthCounts = countLettersByDepth(board);
+    for (uint32_t i: fitting){
+        if (spellsWithDepthRule(index.words[i], depthCounts)){
+            sink.addWord(string(index.words[i]));
+            stats.wordsEmitted++;
+        }
+    }
+    stats.wordsScanned += end - begin;
+    stats.signatureMatches += fitting.size();
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("fitsWithin compares every letter count"){
+    EXPECT(fitsWithin(countLetters("moon"), countLetters("mooon")));
+    EXPECT(!fitsWithin(countLetters("moon"), countLetters("mon")));
+    EXPECT(fitsWithin(countLetters(""), countLetters("")));
+    EXPECT(!fitsWithin(countLetters("zz"), countLetters("zyxa")));
+    EXPECT(fitsWithin(countLetters("azazaz"), countLetters("zzzzaaaa")));
+    EXPECT(!fitsWithin(countLetters("ha"), countLetters("aaaaaaaaaaaaaaaaaaaag")));
+    EXPECT_EQUAL(letterMask("cab"), 7u);
+}
+
+STUDENT_TEST("prefilterDictionary keeps only words the board's letters can spell"){
+    WordTrie trie({"moon", "mono", "moo", "noon", "moonbeam", "onomatopoeia"});
+    SignatureIndex index = buildSignatureIndex(trie);
+    EXPECT(index.words == vector<string>({"mono", "moon", "moonbeam", "noon"}));
+    CompactTile tiles[] = {CompactTile('m',1,1), CompactTile('o',1,2), CompactTile('o',1,3),
+                           CompactTile('o',1,4), CompactTile('n',3,1)};
+    TileBoard board = makeTileBoard(tiles, 5);
+    WordTrie filtered = prefilterDictionary(board, index);
+    EXPECT_EQUAL(filtered.size(), 2);
+    EXPECT(filtered.contains("moon"));
+    EXPECT(filtered.contains("mono"));
+}
+
+STUDENT_TEST("Each WordTrie keeps the SignatureIndex of its own words"){
+    for (string word: {"moon", "noon"}){
+        WordTrie trie({word});   // each round's trie may sit where the last one did
+        EXPECT(trie.signatureIndex().words == vector<string>({word}));
+    }
+    WordTrie moved({"mono", "moon"});
+    EXPECT_EQUAL(moved.signatureIndex().words.size(), 2u);
+    WordTrie target = std::move(moved);
+    EXPECT_EQUAL(target.signatureIndex().words.size(), 2u);
+    moved = WordTrie({"noon"});
+    EXPECT(moved.signatureIndex().words == vector<string>({"noon"}));
+}
+
+STUDENT_TEST("Prefiltered solve finds the same words as the full dictionary"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    const SignatureIndex& index = trie.signatureIndex();
+    Set<LetterTile> tiles = stringToLetterTile("qxetIZxUwkQixzr",1) +
+            stringToLetterTile("jpquxzd",2) + stringToLetterTile("u",3);
+    TileBoard board = makeTileBoard(tiles);
+    SolverOptions fullDictionary;
+    fullDictionary.prefilter = false;
+    fullDictionary.engine = SolverEngine::TREE_SEARCH;
+    Set<string> expected, prefiltered;
+    solveBoard(board, trie, expected, fullDictionary);
+    solveBoard(board, prefilterDictionary(board, index), prefiltered, fullDictionary);
+    EXPECT_EQUAL(prefiltered, expected);
+    EXPECT_EQUAL(prefiltered.size(), 65);
+
+    CompactTile noWords[] = {CompactTile('z',1,1), CompactTile('j',1,2), CompactTile('q',1,3),
+                             CompactTile('x',2,1), CompactTile('x',3,1)};
+    EXPECT_EQUAL(wordsFittingBoard(makeTileBoard(noWords, 5), index).size(), 0u);
+}
+
+STUDENT_TEST("spellsWithDepthRule follows the depth rule of updateAvailableTiles"){
+    DepthLetterCounts board = countLettersByDepth(makeRingBoard("POR", "WE", "R"));
+    EXPECT_EQUAL(board.numDepths, 3);
+    EXPECT(spellsWithDepthRule("prower", board));    // p o r, then w e, then the inner r
+    EXPECT(spellsWithDepthRule("rope", board));
+    EXPECT(!spellsWithDepthRule("wore", board));     // o is shallower than w
+    EXPECT(!spellsWithDepthRule("error", board));    // only two r tiles
+    EXPECT(!spellsWithDepthRule("prop", board));     // only one p
+    DepthLetterCounts gapped = countLettersByDepth(makeRingBoard("MOO", "", "ON"));
+    EXPECT_EQUAL(gapped.numDepths, 2);
+    EXPECT(spellsWithDepthRule("moon", gapped));
+    EXPECT(!spellsWithDepthRule("noom", gapped));
+}
+
+STUDENT_TEST("Word scan finds the same words as tree search on boards of every size"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    SolverOptions tree, scan;
+    tree.engine = SolverEngine::TREE_SEARCH;
+    scan.engine = SolverEngine::WORD_SCAN;
+    const char* rings[][3] = {{"POR", "WE", "R"}, {"MOOOTOO", "NOOT", "O"}, {"a", "", ""},
+                              {"zqwrtuopjikqezxv", "ugztyeio", "t"}, {"eeeeaaaassssrrrr", "tttniiol", "e"}};
+    for (const auto& ring: rings){
+        TileBoard board = makeRingBoard(ring[0], ring[1], ring[2]);
+        Set<string> treeWords, scanWords;
+        solveBoard(board, trie, treeWords, tree);
+        solveBoard(board, trie, scanWords, scan);
+        EXPECT_EQUAL(scanWords, treeWords);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "boardsolver.h"
+#include "wordtrie.h"
+
+/* * * * * * DICTIONARY PREFILTER * * * * * */
+
+/**
+ * Type representing how many times each letter appears in a word or on a
+ * board. Letter 'a' + c is byte c of the 32 one-byte lanes, so comparing two
+ * LetterCounts is four 64-bit operations instead of 26 separate comparisons.
+ * Counts must stay below 128.
+ */
+struct alignas(32) LetterCounts {
+    uint64_t lanes[4];
+};
+
+/**
+ * Returns the LetterCounts of a word or of the tiles of a board.
+ */
+LetterCounts countLetters(const std::string& word);
+LetterCounts countLetters(const TileBoard& board);
+
+/**
+ * Returns whether every letter occurs in 'word' at most as many times as in
+ * 'board'. Each lane of board + 0x80 minus the matching lane of word keeps its
+ * high bit exactly when the word's count is not larger, so all 32 lanes are
+ * compared at once without any lane borrowing from its neighbour.
+ */
+inline bool fitsWithin(const LetterCounts& word, const LetterCounts& board) {
+    const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+    uint64_t fits = HIGH_BITS;
+    for (int i = 0; i < 4; i++) {
+        fits &= (board.lanes[i] | HIGH_BITS) - word.lanes[i];
+    }
+    return fits == HIGH_BITS;
+}
+
+/**
+ * Returns the mask of letters in a word or on a board, bit 0 being 'a'.
+ */
+uint32_t letterMask(const std::string& word);
+uint32_t letterMask(const TileBoard& board);
+
+/**
+ * Type representing every dictionary word of a playable length alongside its
+ * letter mask and LetterCounts, precomputed once per dictionary so filtering a
+ * board never has to look at the letters of a word.
+ */
+struct SignatureIndex {
+    std::vector<std::string> words;     /// words between MIN_WORD_LENGTH and MAX_WORD_LENGTH letters, sorted
+    std::vector<uint32_t> masks;        /// letterMask() of each word
+    std::vector<LetterCounts> counts;   /// countLetters() of each word
+};
+
+/**
+ * Returns the SignatureIndex of the words in 'trie'.
+ */
+SignatureIndex buildSignatureIndex(const WordTrie& trie);
+
+/**
+ * Returns the words of 'index' whose letters all fit within the tiles of
+ * 'board', ignoring the depth rule. These are the only words the board could
+ * possibly spell.
+ */
+std::vector<std::string> wordsFittingBoard(const TileBoard& board, const SignatureIndex& index);
+
+/**
+ * Returns a WordTrie holding only the words of 'index' that fit within the
+ * tiles of 'board', for the depth-constrained search to run against.
+ */
+WordTrie prefilterDictionary(const TileBoard& board, const SignatureIndex& index);
+
+/* * * * * * WORD-CENTRIC ENGINE * * * * * */
+
+/**
+ * Type representing how many tiles of each letter a board holds at each of its
+ * depths, with the board's distinct depths numbered from the outermost in.
+ */
+struct DepthLetterCounts {
+    int numDepths;                     /// number of distinct depths on the board
+    uint8_t counts[MAX_TILES][26];     /// counts[d][c] is the number of tiles of letter 'a' + c at depth d
+};
+
+/**
+ * Returns the DepthLetterCounts of the tiles of 'board'.
+ */
+DepthLetterCounts countLettersByDepth(const TileBoard& board);
+
+/**
+ * Returns whether the letters of 'word' can be given distinct tiles of 'board'
+ * whose depths never decrease from one letter to the next. That is exactly
+ * when the word can be spelled following the rule of updateAvailableTiles().
+ */
+bool spellsWithDepthRule(const std::string& word, const DepthLetterCounts& board);
+
+/**
+ * Sends to 'sink', in alphabetical order, every word of 'index' that 'board'
+ * can spell. Rather than searching the tiles, it checks each word in turn:
+ * first its letter signature against the board's, then its letters against the
+ * depth rule. This costs the same for any board, so it wins on large boards,
+ * whose tile search is deep and wide.
+ */
+void scanDictionary(const TileBoard& board, const SignatureIndex& index, WordSink& sink);
+
+/**
+ * Scans only the words of 'index' from 'begin' up to but not including 'end',
+ * so that pieces of one scan can run on different threads, and adds the words
+ * it checked, matched by signature and sent to the sink to 'stats'.
+ */
+void scanDictionary(const TileBoard& board, const SignatureIndex& index, std::size_t begin,
+                    std::size_t end, WordSink& sink, SolverStats& stats);
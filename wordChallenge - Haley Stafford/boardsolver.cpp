@@ -0,0 +1,1115 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "boardsolver.h"
+#include "boardfilter.h"
+#include "workstealingpool.h"
+#include "error.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/** The checkTileCount() function raises an error if a board has more tiles
+ * than fit in a mask.
+ */
+static void checkTileCount(int numTiles){
+    if (numTiles > MAX_TILES){
+        error("makeTileBoard: board has " + to_string(numTiles) + " tiles, at most "
+              + to_string(MAX_TILES) + " are supported");
+    }
+}
+
+/** The makeTileBoard() function takes in an array of CompactTiles and numbers
+ * the tiles in array order. For each tile it precomputes the mask of tiles whose
+ * depth is at least that tile's depth, so the depth rule costs a single AND
+ * during the search, and the mask of earlier tiles identical to it but for their
+ * uniqueID. It also records which tiles carry each letter.
+ */
+TileBoard makeTileBoard(const CompactTile* tiles, int numTiles){
+    checkTileCount(numTiles);
+    TileBoard board;
+    board.numTiles = numTiles;
+    board.allTiles = 0;
+    fill(board.tilesOfLetter, board.tilesOfLetter + 26, 0);
+    for (int i = 0; i < numTiles; i++){
+        board.tiles[i] = tiles[i];
+        board.allTiles |= uint32_t(1) << i;
+        unsigned letter = unsigned(tiles[i].letter - 'a');
+        if (letter < 26) board.tilesOfLetter[letter] |= uint32_t(1) << i;
+    }
+    for (int i = 0; i < numTiles; i++){
+        board.sameOrDeeper[i] = 0;
+        board.sameTileBefore[i] = 0;
+        for (int j = 0; j < numTiles; j++){
+            if (board.tiles[j].depth >= board.tiles[i].depth){
+                board.sameOrDeeper[i] |= uint32_t(1) << j;
+            }
+            if (j < i && board.tiles[j].letter == board.tiles[i].letter
+                      && board.tiles[j].depth == board.tiles[i].depth){
+                board.sameTileBefore[i] |= uint32_t(1) << j;
+            }
+        }
+    }
+    return board;
+}
+
+/** This makeTileBoard() overload numbers the tiles of a Set<LetterTile> in Set
+ * order.
+ */
+TileBoard makeTileBoard(const Set<LetterTile>& tiles){
+    checkTileCount(tiles.size());
+    CompactTile compact[MAX_TILES];
+    int numTiles = 0;
+    for (const LetterTile& tile: tiles){
+        compact[numTiles++] = toCompactTile(tile);
+    }
+    return makeTileBoard(compact, numTiles);
+}
+
+TileBoard makeRingBoard(const string& outer, const string& middle, const string& inner){
+    const string* rings[] = {&outer, &middle, &inner};
+    CompactTile tiles[MAX_TILES];
+    int numTiles = 0;
+    for (int depth = 1; depth <= 3; depth++){
+        const string& ring = *rings[depth - 1];
+        checkTileCount(numTiles + int(ring.length()));
+        for (size_t i = 0; i < ring.length(); i++){
+            if (!isalpha(ring[i])){
+                error("makeRingBoard: ring " + to_string(depth) + " contains non-letter '" + ring.substr(i, 1) + "'");
+            }
+            tiles[numTiles++] = CompactTile(char(tolower(ring[i])), depth, int(i) + 1);
+        }
+    }
+    return makeTileBoard(tiles, numTiles);
+}
+
+/* Solver statistics. While it searches, each thread counts into its own
+ * searchStats, so counting needs no atomics, and every SOLVER_STAT() in the
+ * search compiles to nothing unless SOLVER_STATS is defined.
+ */
+#ifdef SOLVER_STATS
+#define SOLVER_STAT(statement) do { statement; } while (0)
+static thread_local SolverStats searchStats;
+#else
+#define SOLVER_STAT(statement) do {} while (0)
+#endif
+
+static thread_local SolverStats lastStats;   // totals of this thread's last solveBoard()
+
+SolverStats& SolverStats::operator+=(const SolverStats& other){
+    nodesExpanded += other.nodesExpanded;
+    prefixHits += other.prefixHits;
+    prefixMisses += other.prefixMisses;
+    for (int depth = 0; depth <= MAX_WORD_LENGTH; depth++){
+        prunedAtDepth[depth] += other.prunedAtDepth[depth];
+    }
+    wordsEmitted += other.wordsEmitted;
+    statesReused += other.statesReused;
+    wordsScanned += other.wordsScanned;
+    signatureMatches += other.signatureMatches;
+    maxDepth = max(maxDepth, other.maxDepth);
+    return *this;
+}
+
+/** The collectSearchStats() function moves what the calling thread has counted
+ * since it last collected into 'total'.
+ */
+static void collectSearchStats(SolverStats& total){
+#ifdef SOLVER_STATS
+    total += searchStats;
+    searchStats = SolverStats();
+#else
+    (void) total;
+#endif
+}
+
+SolverStats lastSolverStats(){
+    return lastStats;
+}
+
+void addSolverStatsDetail(const SolverStats& stats){
+    if (!SOLVER_STATS_ENABLED){
+        addDetail("Solver stats are off; build with SOLVER_STATS defined to collect them");
+        return;
+    }
+    ostringstream summary;
+    summary << "Solver stats: " << stats.nodesExpanded << " nodes expanded, "
+            << stats.prefixHits << " prefix hits, " << stats.prefixMisses << " prefix misses, "
+            << stats.wordsEmitted << " words emitted, " << stats.statesReused << " states reused, "
+            << "max depth " << stats.maxDepth;
+    if (stats.wordsScanned > 0){
+        summary << ", " << stats.wordsScanned << " words scanned, "
+                << stats.signatureMatches << " signature matches";
+    }
+    addDetail(summary.str());
+    ostringstream pruned;
+    pruned << "Pruned by depth:";
+    for (int depth = 1; depth <= MAX_WORD_LENGTH; depth++){
+        pruned << " " << depth << ": " << stats.prunedAtDepth[depth];
+    }
+    addDetail(pruned.str());
+}
+
+/**
+ * Type through which the search hands its words to a WordSink. A word ends at
+ * exactly one trie node, so one bit per node is enough to send each word to the
+ * sink once however many tile paths spell it, without looking the word up in a
+ * Set. The bits are atomic so the workers of a parallel solve can share them.
+ */
+class FoundWords {
+public:
+    explicit FoundWords(const WordTrie& trie) : claimed((trie.nodeCount() + 63) / 64) {}
+
+    /** Sends the word of 'length' letters in 'word', which ends at the node of
+     * 'cursor', to 'sink' unless it has been sent before.
+     */
+    void add(const TrieCursor& cursor, const char* word, int length, WordSink& sink){
+        uint32_t node = cursor.index();
+        uint64_t bit = uint64_t(1) << (node % 64);
+        if ((claimed[node / 64].fetch_or(bit, memory_order_relaxed) & bit) == 0){
+            SOLVER_STAT(searchStats.wordsEmitted++);
+            sink.addWord(string(word, length));
+        }
+    }
+
+private:
+    vector<atomic<uint64_t>> claimed;
+};
+
+/**
+ * Type representing the transposition table of a search: the states solveFrom()
+ * has already expanded, each a trie node and the tiles still available there.
+ * The node fixes the prefix and the tiles fix every way to extend it, so once a
+ * state is searched all of its words are in FoundWords, and reaching it again
+ * by another path can be skipped. The depth rule makes that common, since
+ * choosing a deep tile drops every shallower one, forgetting which of them the
+ * path took.
+ *
+ * The table is direct-mapped, so a state landing in a taken slot evicts the one
+ * there, which costs at most a repeated search. Each thread keeps one table for
+ * all its searches and tells the current search's entries apart by generation
+ * instead of clearing it.
+ */
+class SearchedStates {
+public:
+    explicit SearchedStates(bool enabled) : slots(nullptr), generation(0){
+        if (!enabled) return;
+        if (table.empty()) table.resize(TABLE_SIZE);
+        if (++lastGeneration == 0){   // wrapped, so old entries would look current
+            fill(table.begin(), table.end(), Slot());
+            lastGeneration = 1;
+        }
+        slots = table.data();
+        generation = lastGeneration;
+    }
+
+    /** Records that the search reached 'node' with 'available' tiles left, and
+     * returns whether that state is new to this search.
+     */
+    bool firstVisit(uint32_t node, uint32_t available){
+        if (slots == nullptr) return true;
+        uint64_t state = (uint64_t(node) << 32) | available;
+        Slot& slot = slots[(state * 0x9E3779B97F4A7C15ULL) >> (64 - TABLE_BITS)];
+        if (slot.generation == generation && slot.state == state){
+            SOLVER_STAT(searchStats.statesReused++);
+            return false;
+        }
+        slot.state = state;
+        slot.generation = generation;
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint64_t state = 0;
+        uint32_t generation = 0;   // 0 is never current
+    };
+    static const int TABLE_BITS = 13;
+    static const size_t TABLE_SIZE = size_t(1) << TABLE_BITS;
+    static thread_local vector<Slot> table;
+    static thread_local uint32_t lastGeneration;
+
+    Slot* slots;   // null when disabled
+    uint32_t generation;
+};
+
+thread_local vector<SearchedStates::Slot> SearchedStates::table;
+thread_local uint32_t SearchedStates::lastGeneration = 0;
+
+/** The isRepeatedTile() function returns whether an identical copy of 'tile'
+ * with a lower number is also in 'available'. Choosing either copy leaves the
+ * same tiles but for which copy remains, so the search only expands the
+ * lowest-numbered copy and each distinct (letter, depth) once.
+ */
+static inline bool isRepeatedTile(const TileBoard& board, uint32_t available, int tile){
+    return (available & board.sameTileBefore[tile]) != 0;
+}
+
+/** The withDuplicatesExpanded() function returns a copy of 'board' whose
+ * tiles have no identical copies as far as isRepeatedTile() can tell, so a
+ * search expands every copy.
+ */
+static TileBoard withDuplicatesExpanded(const TileBoard& board){
+    TileBoard expanded = board;
+    fill(expanded.sameTileBefore, expanded.sameTileBefore + MAX_TILES, 0);
+    return expanded;
+}
+
+#ifdef SOLVER_STATS
+/** The countPrefixMisses() function counts the tiles in 'available' that no
+ * letter in 'childLetters' can use, which are the extensions of a prefix of
+ * 'length' letters that the dictionary rules out. Of several identical tiles
+ * only one is counted, as solveFrom() only tries one.
+ */
+static void countPrefixMisses(const TileBoard& board, uint32_t available, uint32_t childLetters, int length){
+    uint32_t reachable = 0;
+    for (uint32_t letters = childLetters; letters != 0; letters &= letters - 1){
+        reachable |= board.tilesOfLetter[__builtin_ctz(letters)];
+    }
+    int misses = 0;
+    for (uint32_t dead = available & ~reachable; dead != 0; dead &= dead - 1){
+        if (!isRepeatedTile(board, available, __builtin_ctz(dead))) misses++;
+    }
+    searchStats.prefixMisses += misses;
+    searchStats.prunedAtDepth[length + 1] += misses;
+}
+#endif
+
+/** The solveFrom() function extends the 'length' letters already in 'word' by
+ * every tile in the 'available' mask, sending each valid word it spells to
+ * 'sink' and recursing while the dictionary still has words beginning
+ * with the extended prefix. The cursor 'prefix' sits on the trie node for the
+ * letters in 'word', so each extension is a single step down the trie rather
+ * than a fresh lookup of the whole prefix from the root. The word buffer is
+ * shared by every level of the recursion, so no tiles or strings are copied on
+ * the way down.
+ *
+ * The loop runs over the letters the node has children for rather than over
+ * the tiles: ANDing a letter's tiles with 'available' tells at once whether any
+ * tile can extend the prefix by it, so tiles whose letters begin no word are
+ * never looked at. Of several identical tiles, only one is tried, and a state
+ * 'searched' has seen before is not searched again.
+ */
+static void solveFrom(const TileBoard& board, uint32_t available, TrieCursor prefix,
+                      char* word, int length, FoundWords& found, SearchedStates& searched,
+                      WordSink& sink){
+    SOLVER_STAT(searchStats.nodesExpanded++);
+    uint32_t childLetters = prefix.childLetters();
+    SOLVER_STAT(countPrefixMisses(board, available, childLetters, length));   // Base Case: no word begins with these prefixes
+    for (uint32_t letters = childLetters; letters != 0; letters &= letters - 1){
+        int letter = __builtin_ctz(letters);
+        uint32_t tiles = available & board.tilesOfLetter[letter];
+        if (tiles == 0) continue;
+        TrieCursor extended = prefix;
+        extended.advance(char('a' + letter));
+        word[length] = char('a' + letter);
+        if (length + 1 >= MIN_WORD_LENGTH && extended.isWord()){
+            found.add(extended, word, length + 1, sink);
+        }
+        bool canGrow = length + 1 < MAX_WORD_LENGTH && extended.hasChildren();
+        for (; tiles != 0; tiles &= tiles - 1){
+            int tile = __builtin_ctz(tiles);
+            if (isRepeatedTile(board, available, tile)) continue;
+            SOLVER_STAT(searchStats.prefixHits++; searchStats.maxDepth = max(searchStats.maxDepth, length + 1));
+            uint32_t nextAvailable = tilesAfterChoosing(board, available, tile);
+            if (canGrow && nextAvailable != 0 && searched.firstVisit(extended.index(), nextAvailable)){
+                solveFrom(board, nextAvailable, extended, word, length + 1, found, searched, sink); // Recursive Case: explore if building valid word
+            }
+        }
+    }
+}
+
+/**
+ * Type representing one independent piece of the search: every word that
+ * begins with the given first tile, or with the given first two tiles.
+ */
+struct Subtree {
+    int tiles[2];   /// board indices of the tiles the words begin with
+    int length;     /// number of entries of 'tiles' in use
+};
+
+/** The searchSubtree() function replays the tiles that pick out 'subtree' and
+ * searches everything below them.
+ */
+static void searchSubtree(const TileBoard& board, const WordTrie& trie, const Subtree& subtree,
+                          FoundWords& found, bool reuseStates, WordSink& sink){
+    char word[MAX_WORD_LENGTH];
+    TrieCursor prefix(trie);
+    uint32_t available = board.allTiles;
+    for (int i = 0; i < subtree.length; i++){
+        int tile = subtree.tiles[i];
+        if (!prefix.advance(board.tiles[tile].letter)) return;
+        word[i] = board.tiles[tile].letter;
+        available = tilesAfterChoosing(board, available, tile);
+    }
+    if (subtree.length >= MIN_WORD_LENGTH && prefix.isWord()){
+        found.add(prefix, word, subtree.length, sink);
+    }
+    if (available != 0 && subtree.length < MAX_WORD_LENGTH && prefix.hasChildren()){
+        SearchedStates searched(reuseStates);
+        solveFrom(board, available, prefix, word, subtree.length, found, searched, sink);
+    }
+}
+
+/** The splitSearch() function lists the subtrees of the search, one per first
+ * tile that begins some word. When that leaves too few subtrees to keep every
+ * worker busy, as on a small board or one whose letters begin few words, each
+ * is split again by its second tile. No word is shorter than two tiles, so the
+ * two-tile subtrees still cover every word.
+ */
+static vector<Subtree> splitSearch(const TileBoard& board, const WordTrie& trie, int workers){
+    static_assert(MIN_WORD_LENGTH > 2, "splitting by two tiles would skip shorter words");
+    vector<Subtree> firstTiles;
+    for (int tile = 0; tile < board.numTiles; tile++){
+        if (isRepeatedTile(board, board.allTiles, tile)) continue;
+        if (trie.child(trie.root(), board.tiles[tile].letter) != TRIE_NO_NODE){
+            firstTiles.push_back(Subtree{{tile, -1}, 1});
+        }
+    }
+    const int SUBTREES_PER_WORKER = 4;
+    if (int(firstTiles.size()) >= workers * SUBTREES_PER_WORKER){
+        return firstTiles;
+    }
+    vector<Subtree> subtrees;
+    for (const Subtree& first: firstTiles){
+        int tile = first.tiles[0];
+        uint32_t prefix = trie.child(trie.root(), board.tiles[tile].letter);
+        uint32_t available = tilesAfterChoosing(board, board.allTiles, tile);
+        for (uint32_t remaining = available; remaining != 0; remaining &= remaining - 1){
+            int second = __builtin_ctz(remaining);
+            if (isRepeatedTile(board, available, second)) continue;
+            if (trie.child(prefix, board.tiles[second].letter) != TRIE_NO_NODE){
+                subtrees.push_back(Subtree{{tile, second}, 2});
+            }
+        }
+    }
+    return subtrees;
+}
+
+/** The searchTrie() function runs the depth-constrained search of 'board'
+ * against 'trie', on the calling thread or split across a work-stealing pool.
+ * Every worker moves its words into its own buffer, and the buffers are handed
+ * to 'sink' on the calling thread once all subtrees are done, so sinks never
+ * need to be thread-safe. The workers share one FoundWords, so no word lands in
+ * two buffers, while each subtree skips only the states it has searched itself.
+ * Solver statistics are gathered per worker the same way and added
+ * to 'stats'; since each piece replays its first tiles, a parallel solve counts
+ * a little differently from a serial one.
+ */
+static void searchTrie(const TileBoard& board, const WordTrie& trie, WordSink& sink,
+                       const SolverOptions& options, SolverStats& stats){
+    if (trie.nodeCount() == 0) return;
+    FoundWords found(trie);
+    bool reuseStates = options.reuseStates;
+    if (workerCount(options.threads) == 1){
+        char word[MAX_WORD_LENGTH];
+        SearchedStates searched(reuseStates);
+        solveFrom(board, board.allTiles, TrieCursor(trie), word, 0, found, searched, sink);
+        collectSearchStats(stats);
+        return;
+    }
+    WorkStealingPool& pool = sharedPool(options.threads);
+    vector<Subtree> subtrees = splitSearch(board, trie, pool.size());
+    vector<vector<string>> workerWords(pool.size());
+    vector<SolverStats> workerStats(pool.size());
+    vector<WorkStealingPool::Task> tasks;
+    for (const Subtree& subtree: subtrees){
+        tasks.push_back([&board, &trie, &found, &workerWords, &workerStats, subtree, reuseStates](int worker){
+            VectorSink buffer(workerWords[worker]);
+            searchSubtree(board, trie, subtree, found, reuseStates, buffer);
+            collectSearchStats(workerStats[worker]);
+        });
+    }
+    pool.runAll(tasks);
+    for (const SolverStats& counted: workerStats){
+        stats += counted;
+    }
+    for (vector<string>& words: workerWords){
+        for (string& word: words){
+            sink.addWord(move(word));
+        }
+    }
+}
+
+/** The usesWordScan() function returns whether 'options' pick the word scan
+ * engine for 'board'. The tree search of a small board visits few nodes, while
+ * the word scan always looks at every word, so the scan only pays once the
+ * board is large enough for its tree to branch widely.
+ */
+static bool usesWordScan(const TileBoard& board, const SolverOptions& options){
+    switch (options.engine){
+        case SolverEngine::WORD_SCAN:   return true;
+        case SolverEngine::TREE_SEARCH: return false;
+        default:                        return board.numTiles >= WORD_SCAN_MIN_TILES;
+    }
+}
+
+/** The scanTrie() function runs the word scan of 'board' against the words of
+ * 'trie', on the calling thread or split into ranges of the SignatureIndex
+ * across a work-stealing pool. Each range keeps its words in a buffer of its
+ * own, and the buffers are handed to 'sink' in range order on the calling
+ * thread, so the words still arrive in alphabetical order. What the scan did is
+ * added to 'stats'.
+ */
+static void scanTrie(const TileBoard& board, const WordTrie& trie, WordSink& sink, int threads,
+                     SolverStats& stats){
+    const SignatureIndex& index = trie.signatureIndex();
+    SolverStats scanned;
+    if (workerCount(threads) == 1){
+        scanDictionary(board, index, 0, index.words.size(), sink, scanned);
+        if (SOLVER_STATS_ENABLED) stats += scanned;
+        return;
+    }
+    const int RANGES_PER_WORKER = 4;
+    WorkStealingPool& pool = sharedPool(threads);
+    size_t numRanges = size_t(pool.size() * RANGES_PER_WORKER);
+    size_t numWords = index.words.size();
+    vector<vector<string>> rangeWords(numRanges);
+    vector<SolverStats> rangeStats(numRanges);
+    vector<WorkStealingPool::Task> tasks;
+    for (size_t range = 0; range < numRanges; range++){
+        size_t begin = numWords * range / numRanges;
+        size_t end = numWords * (range + 1) / numRanges;
+        tasks.push_back([&board, &index, &rangeWords, &rangeStats, range, begin, end](int){
+            VectorSink buffer(rangeWords[range]);
+            scanDictionary(board, index, begin, end, buffer, rangeStats[range]);
+        });
+    }
+    pool.runAll(tasks);
+    for (const SolverStats& counted: rangeStats){
+        scanned += counted;
+    }
+    if (SOLVER_STATS_ENABLED) stats += scanned;
+    for (vector<string>& words: rangeWords){
+        for (string& word: words){
+            sink.addWord(move(word));
+        }
+    }
+}
+
+/** The solveBoard() function either scans the dictionary word by word or
+ * searches the tiles. Before a tree search it optionally narrows the dictionary
+ * to the words whose letters fit on the board. The prefiltered trie holds only
+ * words the board could spell, so the search abandons dead prefixes far
+ * earlier, and a board that can spell nothing skips the search entirely.
+ */
+void solveBoard(const TileBoard& board, const WordTrie& trie, WordSink& sink,
+                const SolverOptions& options){
+    if (usesWordScan(board, options)){
+        SolverStats stats;
+        scanTrie(board, trie, sink, options.threads, stats);
+        lastStats = stats;
+        return;
+    }
+    if (!options.collapseDuplicates){
+        SolverOptions collapsing = options;
+        collapsing.collapseDuplicates = true;
+        solveBoard(withDuplicatesExpanded(board), trie, sink, collapsing);
+        return;
+    }
+    SolverStats stats;
+    if (options.prefilter){
+        WordTrie boardTrie = prefilterDictionary(board, trie.signatureIndex());
+        if (boardTrie.size() > 0){
+            searchTrie(board, boardTrie, sink, options, stats);
+        }
+    } else {
+        searchTrie(board, trie, sink, options, stats);
+    }
+    lastStats = stats;
+}
+
+void solveBoard(const TileBoard& board, const Lexicon& lex, WordSink& sink,
+                const SolverOptions& options){
+    solveBoard(board, *trieForLexicon(lex), sink, options);
+}
+
+void solveBoard(const TileBoard& board, const WordTrie& trie, Set<string>& validWords,
+                const SolverOptions& options){
+    SetSink sink(validWords);
+    solveBoard(board, trie, sink, options);
+}
+
+void solveBoard(const TileBoard& board, const Lexicon& lex, Set<string>& validWords,
+                const SolverOptions& options){
+    SetSink sink(validWords);
+    solveBoard(board, *trieForLexicon(lex), sink, options);
+}
+
+/**
+ * Type representing the best words found so far by the scoring search, kept in
+ * ranking order. Each word is held once, with the tiles of its best path.
+ */
+struct TopWords {
+    struct Entry {
+        string word;
+        int score;
+        int tiles[MAX_WORD_LENGTH];   /// board indices of the tiles spelling 'word'
+    };
+
+    int k;
+    vector<Entry> best;
+
+    explicit TopWords(int k) : k(k) {}
+
+    /** Lowest score a path can reach and still make the list: once 'k' words
+     * are held, anything scoring below the worst of them is out of the running.
+     * Ties still count, since they are broken alphabetically.
+     */
+    int threshold() const {
+        return int(best.size()) < k ? INT_MIN : best.back().score;
+    }
+
+    void offer(const char* letters, int length, int score, const int* tiles);
+};
+
+/** The ranksBefore() function orders words by score, best first, and words
+ * with equal scores alphabetically.
+ */
+static bool ranksBefore(int score, const string& word, const TopWords::Entry& other){
+    return score > other.score || (score == other.score && word < other.word);
+}
+
+/** The offer() function keeps the word if it makes the top 'k', replacing the
+ * word's earlier entry when this path scores higher.
+ */
+void TopWords::offer(const char* letters, int length, int score, const int* tiles){
+    string word(letters, length);
+    for (size_t i = 0; i < best.size(); i++){
+        if (best[i].word == word){
+            if (score <= best[i].score) return;
+            best.erase(best.begin() + i);
+            break;
+        }
+    }
+    if (int(best.size()) == k){
+        if (!ranksBefore(score, word, best.back())) return;
+        best.pop_back();
+    }
+    size_t position = 0;
+    while (position < best.size() && !ranksBefore(score, word, best[position])){
+        position++;
+    }
+    Entry entry;
+    entry.word = word;
+    entry.score = score;
+    copy(tiles, tiles + length, entry.tiles);
+    best.insert(best.begin() + position, entry);
+}
+
+/**
+ * Type holding the state of one scoring search: the path being built and the
+ * tiles of the board ordered from highest value to lowest.
+ */
+struct ScoreSearch {
+    const TileBoard& board;
+    TopWords& top;
+    int byValue[MAX_TILES];
+    char word[MAX_WORD_LENGTH];
+    int tiles[MAX_WORD_LENGTH];
+
+    ScoreSearch(const TileBoard& board, TopWords& top) : board(board), top(top){
+        for (int i = 0; i < board.numTiles; i++){
+            byValue[i] = i;
+        }
+        stable_sort(byValue, byValue + board.numTiles, [&board](int a, int b){
+            return board.tiles[a].value > board.tiles[b].value;
+        });
+    }
+
+    /** Upper bound on the score 'letters' more tiles from 'available' can add:
+     * the sum of the values of the best 'letters' tiles still available.
+     */
+    int bestRemaining(uint32_t available, int letters) const {
+        int bound = 0;
+        for (int i = 0; i < board.numTiles && letters > 0; i++){
+            if (available & (uint32_t(1) << byValue[i])){
+                bound += board.tiles[byValue[i]].value;
+                letters--;
+            }
+        }
+        return bound;
+    }
+};
+
+/** The scoreFrom() function is the branch-and-bound version of solveFrom().
+ * It tries the most valuable tiles first so the list of best words fills with
+ * high scores early, and skips any extension whose score plus the best the
+ * remaining tiles could add falls short of the worst word on the list.
+ */
+static void scoreFrom(ScoreSearch& search, uint32_t available, TrieCursor prefix, int length, int score){
+    const TileBoard& board = search.board;
+    for (int i = 0; i < board.numTiles; i++){
+        int tile = search.byValue[i];
+        if (!(available & (uint32_t(1) << tile)) || isRepeatedTile(board, available, tile)) continue;
+        TrieCursor extended = prefix;
+        if (!extended.advance(board.tiles[tile].letter)){
+            continue; // Base Case: no word begins with this prefix
+        }
+        int extendedScore = score + board.tiles[tile].value;
+        search.word[length] = board.tiles[tile].letter;
+        search.tiles[length] = tile;
+        if (length + 1 >= MIN_WORD_LENGTH && extended.isWord()){
+            search.top.offer(search.word, length + 1, extendedScore, search.tiles);
+        }
+        uint32_t nextAvailable = tilesAfterChoosing(board, available, tile);
+        if (nextAvailable != 0 && length + 1 < MAX_WORD_LENGTH && extended.hasChildren()
+                && extendedScore + search.bestRemaining(nextAvailable, MAX_WORD_LENGTH - length - 1)
+                   >= search.top.threshold()){
+            scoreFrom(search, nextAvailable, extended, length + 1, extendedScore); // Recursive Case: could still beat the list
+        }
+    }
+}
+
+/** The scoreSubtree() function replays the tiles that pick out 'subtree' and
+ * runs the scoring search below them.
+ */
+static void scoreSubtree(ScoreSearch& search, const WordTrie& trie, const Subtree& subtree){
+    const TileBoard& board = search.board;
+    TrieCursor prefix(trie);
+    uint32_t available = board.allTiles;
+    int score = 0;
+    for (int i = 0; i < subtree.length; i++){
+        int tile = subtree.tiles[i];
+        if (!prefix.advance(board.tiles[tile].letter)) return;
+        search.word[i] = board.tiles[tile].letter;
+        search.tiles[i] = tile;
+        score += board.tiles[tile].value;
+        available = tilesAfterChoosing(board, available, tile);
+    }
+    if (subtree.length >= MIN_WORD_LENGTH && prefix.isWord()){
+        search.top.offer(search.word, subtree.length, score, search.tiles);
+    }
+    if (available != 0 && subtree.length < MAX_WORD_LENGTH && prefix.hasChildren()){
+        scoreFrom(search, available, prefix, subtree.length, score);
+    }
+}
+
+/** The scoreTrie() function runs the scoring search of 'board' against 'trie'
+ * the same way searchTrie() runs the full search. Every worker keeps its own
+ * top 'k', pruning against its own list, and the lists are merged at the end.
+ * A word's best path lies in some worker's subtrees, and that worker ranks the
+ * word no lower than the merged list does, so no word of the overall top 'k' is
+ * lost.
+ */
+static void scoreTrie(const TileBoard& board, const WordTrie& trie, TopWords& top, int threads){
+    if (trie.nodeCount() == 0) return;
+    if (workerCount(threads) == 1){
+        ScoreSearch search(board, top);
+        scoreFrom(search, board.allTiles, TrieCursor(trie), 0, 0);
+        return;
+    }
+    WorkStealingPool& pool = sharedPool(threads);
+    vector<Subtree> subtrees = splitSearch(board, trie, pool.size());
+    vector<TopWords> workerTop(pool.size(), TopWords(top.k));
+    vector<WorkStealingPool::Task> tasks;
+    for (const Subtree& subtree: subtrees){
+        tasks.push_back([&board, &trie, &workerTop, subtree](int worker){
+            ScoreSearch search(board, workerTop[worker]);
+            scoreSubtree(search, trie, subtree);
+        });
+    }
+    pool.runAll(tasks);
+    for (const TopWords& words: workerTop){
+        for (const TopWords::Entry& entry: words.best){
+            top.offer(entry.word.data(), int(entry.word.length()), entry.score, entry.tiles);
+        }
+    }
+}
+
+Vector<ScoredWord> findTopScoringWords(const TileBoard& board, const WordTrie& trie, int k,
+                                       const SolverOptions& options){
+    Vector<ScoredWord> result;
+    if (k <= 0) return result;
+    if (!options.collapseDuplicates){
+        SolverOptions collapsing = options;
+        collapsing.collapseDuplicates = true;
+        return findTopScoringWords(withDuplicatesExpanded(board), trie, k, collapsing);
+    }
+    TopWords top(k);
+    if (options.prefilter){
+        WordTrie boardTrie = prefilterDictionary(board, trie.signatureIndex());
+        if (boardTrie.size() > 0){
+            scoreTrie(board, boardTrie, top, options.threads);
+        }
+    } else {
+        scoreTrie(board, trie, top, options.threads);
+    }
+    for (const TopWords::Entry& entry: top.best){
+        ScoredWord scored;
+        scored.word = entry.word;
+        scored.score = entry.score;
+        for (size_t i = 0; i < entry.word.length(); i++){
+            scored.path.add(toLetterTile(board.tiles[entry.tiles[i]]));
+        }
+        result.add(scored);
+    }
+    return result;
+}
+
+Vector<ScoredWord> findTopScoringWords(const TileBoard& board, const Lexicon& lex, int k,
+                                       const SolverOptions& options){
+    return findTopScoringWords(board, *trieForLexicon(lex), k, options);
+}
+
+/** The trieForLexicon() function keeps the last few tries it built, most
+ * recently used first, each with the Lexicon it was built from. A Lexicon
+ * carries no version of its own, so a cached trie is reused only for the same
+ * Lexicon object that still holds as many words and starts with the same word
+ * as when the trie was built. That check costs the same however large the
+ * dictionary is, and it catches a dictionary that has grown since or a
+ * different one built where an old one was destroyed. The lock makes the
+ * cache safe to share between threads; callers hold on to the trie through
+ * the returned pointer even after it leaves the cache.
+ */
+shared_ptr<const WordTrie> trieForLexicon(const Lexicon& lex){
+    struct CachedTrie {
+        const Lexicon* lex;
+        int size;
+        string firstWord;
+        shared_ptr<const WordTrie> trie;
+    };
+    const size_t CACHED_TRIES = 4;
+    static mutex lock;
+    static vector<CachedTrie> cachedTries;
+
+    string firstWord = lex.isEmpty() ? "" : *lex.begin();
+    lock_guard<mutex> guard(lock);
+    for (size_t i = 0; i < cachedTries.size(); i++){
+        const CachedTrie& cached = cachedTries[i];
+        if (cached.lex == &lex && cached.size == lex.size() && cached.firstWord == firstWord){
+            rotate(cachedTries.begin(), cachedTries.begin() + i, cachedTries.begin() + i + 1);
+            return cachedTries[0].trie;
+        }
+    }
+    shared_ptr<const WordTrie> built = make_shared<const WordTrie>(buildWordTrie(lex));
+    cachedTries.insert(cachedTries.begin(), CachedTrie{&lex, lex.size(), firstWord, built});
+    if (cachedTries.size() > CACHED_TRIES) cachedTries.pop_back();
+    return built;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("makeTileBoard numbers tiles and builds depth masks"){
+    Set<LetterTile> tiles = {LetterTile("a",1,1), LetterTile("b",2,1), LetterTile("c",3,1)};
+    TileBoard board = makeTileBoard(tiles);
+    EXPECT_EQUAL(board.numTiles, 3);
+    EXPECT_EQUAL(board.allTiles, 7u);
+    EXPECT_EQUAL(board.sameOrDeeper[0], 7u);
+    EXPECT_EQUAL(board.sameOrDeeper[1], 6u);
+    EXPECT_EQUAL(board.sameOrDeeper[2], 4u);
+    EXPECT_EQUAL(tilesAfterChoosing(board, board.allTiles, 1), 4u);
+}
+
+STUDENT_TEST("tilesAfterChoosing matches updateAvailableTiles"){
+    Set<LetterTile> tiles = {LetterTile("p",1,1), LetterTile("o",1,2), LetterTile("w",2,1),
+                             LetterTile("e",2,2), LetterTile("r",3,1)};
+    TileBoard board = makeTileBoard(tiles);
+    int i = 0;
+    for (const LetterTile& tile: tiles){
+        Set<LetterTile> expected = updateAvailableTiles(tiles, tile);
+        uint32_t mask = tilesAfterChoosing(board, board.allTiles, i);
+        EXPECT_EQUAL(__builtin_popcount(mask), expected.size());
+        i++;
+    }
+}
+
+STUDENT_TEST("solveBoard respects depth rule and word length limits"){
+    Lexicon lex = {"pore", "rope", "roper", "erop", "pre", "powers"};
+    Set<LetterTile> tiles = {LetterTile("p",1,1), LetterTile("o",1,2), LetterTile("r",1,3),
+                             LetterTile("e",2,1), LetterTile("r",3,1)};
+    Set<string> validWords;
+    solveBoard(makeTileBoard(tiles), lex, validWords);
+    EXPECT_EQUAL(validWords, {"pore", "rope", "roper"});
+}
+
+STUDENT_TEST("Boards of uppercase LetterTiles find the same words as lowercase ones"){
+    WordTrie trie({"pore", "power", "prow", "rope"});
+    Set<LetterTile> upper = {LetterTile("P",1,1), LetterTile("O",1,2), LetterTile("R",1,3),
+                             LetterTile("W",2,1), LetterTile("E",2,2), LetterTile("R",3,1)};
+    TileBoard board = makeTileBoard(upper);
+    EXPECT_EQUAL(board.tiles[0].letter, 'e');
+    EXPECT_EQUAL(__builtin_popcount(board.tilesOfLetter['r' - 'a']), 2);
+    Set<string> validWords;
+    solveBoard(board, trie, validWords);
+    EXPECT_EQUAL(validWords, {"pore", "power", "prow", "rope"});
+}
+
+STUDENT_TEST("makeTileBoard rejects boards with too many tiles"){
+    Set<LetterTile> tiles;
+    for (int i = 1; i <= MAX_TILES + 1; i++){
+        tiles.add(LetterTile("a",1,i));
+    }
+    EXPECT_ERROR(makeTileBoard(tiles));
+}
+
+STUDENT_TEST("Parallel solve finds the same words as the serial solve"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    Set<LetterTile> tiles = stringToLetterTile("zqwrtuopjikqezxv",1) +
+            stringToLetterTile("ugztyeio",2) + stringToLetterTile("t",3);
+    TileBoard board = makeTileBoard(tiles);
+    Set<string> serial;
+    solveBoard(board, trie, serial);
+    for (int threads: {0, 2, 3, 8}){
+        SolverOptions options;
+        options.threads = threads;
+        options.engine = SolverEngine::TREE_SEARCH;
+        Set<string> parallel;
+        solveBoard(board, trie, parallel, options);
+        EXPECT_EQUAL(parallel, serial);
+    }
+    EXPECT_EQUAL(serial.size(), 400);
+}
+
+STUDENT_TEST("Parallel solve splits small boards by their first two tiles"){
+    WordTrie trie({"pore", "power", "prow", "prower", "rope", "roper", "rower"});
+    Set<LetterTile> tiles = stringToLetterTile("POR",1) + stringToLetterTile("WE",2) +
+            stringToLetterTile("R",3);
+    SolverOptions options;
+    options.threads = 4;
+    options.prefilter = false;
+    Set<string> validWords;
+    solveBoard(makeTileBoard(tiles), trie, validWords, options);
+    EXPECT_EQUAL(validWords, {"pore", "power", "prow", "prower", "rope", "roper", "rower"});
+}
+
+
+STUDENT_TEST("findTopScoringWords ranks words by their best path"){
+    WordTrie trie({"pore", "power", "prow", "prower", "rope", "roper", "rower"});
+    TileBoard board = makeRingBoard("POR", "WE", "R");
+    // values: p o r = 1, w = 2 + 4, e = 2 + 1, inner r = 3 + 2
+    Vector<ScoredWord> best = findTopScoringWords(board, trie, 3);
+    EXPECT_EQUAL(best.size(), 3);
+    EXPECT_EQUAL(best[0].word, "prower");
+    EXPECT_EQUAL(best[0].score, 1 + 1 + 1 + 6 + 3 + 5);
+    EXPECT_EQUAL(best[1].word, "power");
+    EXPECT_EQUAL(best[1].score, 1 + 1 + 6 + 3 + 5);
+    EXPECT_EQUAL(best[2].word, "rower");
+    EXPECT_EQUAL(best[2].path.size(), 5);
+    EXPECT_EQUAL(best[2].path[0].depth, 1);    // the outer r, saving the inner r for the end
+    EXPECT_EQUAL(best[2].path[4].depth, 3);
+    int total = 0;
+    for (const LetterTile& tile: best[2].path){
+        total += tile.value;
+    }
+    EXPECT_EQUAL(total, best[2].score);
+    EXPECT_EQUAL(findTopScoringWords(board, trie, 0).size(), 0);
+    EXPECT_EQUAL(findTopScoringWords(board, trie, 50).size(), 7);
+}
+
+STUDENT_TEST("findTopScoringWords agrees with scoring every word of solveBoard"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    TileBoard board = makeRingBoard("zqwrtuopjikqezxv", "ugztyeio", "t");
+    Vector<ScoredWord> all = findTopScoringWords(board, trie, 1000);
+    EXPECT_EQUAL(all.size(), 400);
+    for (int i = 1; i < all.size(); i++){
+        EXPECT(all[i - 1].score >= all[i].score);
+    }
+    for (int threads: {1, 3}){
+        for (bool prefilter: {true, false}){
+            SolverOptions options;
+            options.threads = threads;
+            options.prefilter = prefilter;
+            Vector<ScoredWord> top = findTopScoringWords(board, trie, 10, options);
+            EXPECT_EQUAL(top.size(), 10);
+            for (int i = 0; i < top.size(); i++){
+                EXPECT_EQUAL(top[i].word, all[i].word);
+                EXPECT_EQUAL(top[i].score, all[i].score);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("solveBoard sends each word to the sink once"){
+    WordTrie trie({"moon", "mono", "noon"});
+    TileBoard board = makeRingBoard("MOOO", "", "N");   // "moon" can be spelled six ways
+    for (int threads: {1, 2}){
+        SolverOptions options;
+        options.threads = threads;
+        options.prefilter = false;
+        vector<string> words;
+        VectorSink sink(words);
+        solveBoard(board, trie, sink, options);
+        EXPECT(words == vector<string>({"moon"}));
+    }
+}
+
+STUDENT_TEST("WordSummarySink gives the longest words of a solve"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    TileBoard board = makeRingBoard("zqwrtuopjikqezxv", "ugztyeio", "t");
+    Set<string> all;
+    solveBoard(board, trie, all);
+    WordSummarySink summary;
+    solveBoard(board, trie, summary);
+    EXPECT_EQUAL(summary.wordCount(), all.size());
+    EXPECT_EQUAL(summary.longestLength(), MAX_WORD_LENGTH);
+    int total = 0;
+    for (int length = MIN_WORD_LENGTH; length <= MAX_WORD_LENGTH; length++){
+        total += summary.countOfLength(length);
+    }
+    EXPECT_EQUAL(total, all.size());
+    for (const string& word: summary.longestWords()){
+        EXPECT(all.contains(word));
+        EXPECT_EQUAL(int(word.length()), MAX_WORD_LENGTH);
+    }
+}
+
+STUDENT_TEST("Collapsing identical tiles finds the same words with less search"){
+    WordTrie trie({"moon", "mono", "noon", "onto", "otto", "toon", "moot", "motto"});
+    TileBoard board = makeRingBoard("MOOOTOO", "NOOT", "O");
+    EXPECT_EQUAL(board.sameTileBefore[2], 2u);     // the second o of the outer ring repeats the first
+    EXPECT_EQUAL(board.sameTileBefore[7], 0u);     // the first o of the middle ring is at another depth
+    for (int threads: {1, 3}){
+        SolverOptions collapsed, expanded;
+        collapsed.threads = expanded.threads = threads;
+        collapsed.engine = expanded.engine = SolverEngine::TREE_SEARCH;
+        collapsed.reuseStates = expanded.reuseStates = false;   // measure collapsing alone
+        expanded.collapseDuplicates = false;
+        Set<string> collapsedWords, expandedWords;
+        solveBoard(board, trie, collapsedWords, collapsed);
+        SolverStats collapsedStats = lastSolverStats();
+        solveBoard(board, trie, expandedWords, expanded);
+        SolverStats expandedStats = lastSolverStats();
+        EXPECT_EQUAL(collapsedWords, expandedWords);
+        EXPECT_EQUAL(collapsedWords, {"mono", "moon", "moot", "motto", "onto", "otto", "toon"});   // one n, so no noon
+        if (SOLVER_STATS_ENABLED){
+            EXPECT(collapsedStats.nodesExpanded * 4 < expandedStats.nodesExpanded);
+        }
+        EXPECT_EQUAL(findTopScoringWords(board, trie, 3, collapsed)[0].score,
+                     findTopScoringWords(board, trie, 3, expanded)[0].score);
+    }
+}
+
+STUDENT_TEST("lastSolverStats describes the most recent solve"){
+    WordTrie trie({"pore", "power", "prow", "prower", "rope", "roper", "rower"});
+    TileBoard board = makeRingBoard("POR", "WE", "R");
+    SolverOptions options;
+    options.prefilter = false;
+    Set<string> validWords;
+    solveBoard(board, trie, validWords, options);
+    SolverStats stats = lastSolverStats();
+    addSolverStatsDetail(stats);
+    if (SOLVER_STATS_ENABLED){
+        EXPECT_EQUAL(stats.wordsEmitted, 7);
+        EXPECT_EQUAL(stats.maxDepth, 6);
+        long long pruned = 0;
+        for (long long misses: stats.prunedAtDepth){
+            pruned += misses;
+        }
+        EXPECT_EQUAL(pruned, stats.prefixMisses);
+        EXPECT(stats.nodesExpanded > 0 && stats.nodesExpanded <= stats.prefixHits + 1);
+        EXPECT_EQUAL(stats.prunedAtDepth[1], 3);   // no word begins with o, w or e
+    } else {
+        EXPECT_EQUAL(stats.nodesExpanded, 0);
+        EXPECT_EQUAL(stats.wordsEmitted, 0);
+    }
+    EXPECT_EQUAL(validWords.size(), 7);
+}
+
+STUDENT_TEST("makeTileBoard groups tiles by letter for the child-letter search"){
+    TileBoard board = makeRingBoard("POR", "WE", "R");
+    EXPECT_EQUAL(board.tilesOfLetter['r' - 'a'], (1u << 2) | (1u << 5));   // one r outside, one in the center
+    EXPECT_EQUAL(board.tilesOfLetter['w' - 'a'], 1u << 3);
+    EXPECT_EQUAL(board.tilesOfLetter['z' - 'a'], 0u);
+
+    WordTrie trie({"errs", "pews", "prow", "rope", "wore", "zoom"});
+    SolverOptions options;
+    options.prefilter = false;   // the trie keeps zoom, whose z is on no tile
+    options.engine = SolverEngine::TREE_SEARCH;
+    Set<string> validWords;
+    solveBoard(board, trie, validWords, options);
+    EXPECT_EQUAL(validWords, {"prow", "rope"});
+}
+
+STUDENT_TEST("Reusing searched states finds the same words with less search"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    TileBoard board = makeRingBoard("STARE", "TRASE", "ARTS");   // the same letters at every depth
+    for (int threads: {1, 3}){
+        SolverOptions reused, repeated;
+        reused.threads = repeated.threads = threads;
+        reused.engine = repeated.engine = SolverEngine::TREE_SEARCH;
+        repeated.reuseStates = false;
+        Set<string> reusedWords, repeatedWords;
+        solveBoard(board, trie, reusedWords, reused);
+        SolverStats reusedStats = lastSolverStats();
+        solveBoard(board, trie, repeatedWords, repeated);
+        SolverStats repeatedStats = lastSolverStats();
+        EXPECT_EQUAL(reusedWords, repeatedWords);
+        EXPECT(reusedWords.contains("stars"));
+        if (SOLVER_STATS_ENABLED){
+            EXPECT(reusedStats.statesReused > 0);
+            EXPECT_EQUAL(repeatedStats.statesReused, 0);
+            EXPECT(reusedStats.nodesExpanded < repeatedStats.nodesExpanded);
+            addSolverStatsDetail(reusedStats);
+            addSolverStatsDetail(repeatedStats);
+        }
+    }
+}
+
+STUDENT_TEST("trieForLexicon never hands back the trie of another dictionary"){
+    TileBoard board = makeRingBoard("POR", "WE", "R");
+    for (int round = 0; round < 2; round++){
+        Set<string> ropeWords, prowWords;
+        {
+            Lexicon lex = {"pore", "rope"};
+            solveBoard(board, lex, ropeWords);
+        }
+        {
+            Lexicon lex = {"prow", "rope"};   // same size, likely the same address
+            solveBoard(board, lex, prowWords);
+        }
+        EXPECT_EQUAL(ropeWords, {"pore", "rope"});
+        EXPECT_EQUAL(prowWords, {"prow", "rope"});
+    }
+    Lexicon first = {"pore", "rope"};
+    Lexicon second = {"prow", "rope"};
+    shared_ptr<const WordTrie> firstTrie = trieForLexicon(first);
+    EXPECT(trieForLexicon(second) != firstTrie);
+    EXPECT(trieForLexicon(first) == firstTrie);   // switching back reuses the cached trie
+    first.add("prow");
+    EXPECT(trieForLexicon(first) != firstTrie);   // a dictionary that grew gets a new trie
+    EXPECT(trieForLexicon(first)->contains("prow"));
+}
+
+STUDENT_TEST("Large boards split the word scan across the worker threads"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    TileBoard board = makeRingBoard("STRAINEDCOPULARS", "TEAMSORI", "E");
+    EXPECT_EQUAL(board.numTiles, 25);
+    SolverOptions serial, parallel;
+    parallel.threads = 4;
+    vector<string> serialWords, parallelWords;
+    VectorSink serialSink(serialWords), parallelSink(parallelWords);
+    solveBoard(board, trie, serialSink, serial);
+    uint64_t batchesBefore = sharedPool(4).batchCount();
+    solveBoard(board, trie, parallelSink, parallel);
+    EXPECT(sharedPool(4).batchCount() > batchesBefore);
+    EXPECT(parallelWords == serialWords);
+    EXPECT(is_sorted(parallelWords.begin(), parallelWords.end()));
+    EXPECT(serialWords.size() > 1000u);
+}
+
+STUDENT_TEST("The word scan counts what it did in SolverStats"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    TileBoard board = makeRingBoard("STRAINEDCOPULARS", "TEAMSORI", "E");
+    for (int threads: {1, 4}){
+        SolverOptions options;
+        options.threads = threads;
+        CountingSink words;
+        solveBoard(board, trie, words, options);
+        SolverStats stats = lastSolverStats();
+        if (SOLVER_STATS_ENABLED){
+            EXPECT_EQUAL(stats.wordsScanned, (long long) trie.signatureIndex().words.size());
+            EXPECT_EQUAL(stats.wordsEmitted, words.count());
+            EXPECT(stats.signatureMatches >= stats.wordsEmitted);
+        } else {
+            EXPECT_EQUAL(stats.wordsScanned, 0);
+        }
+        addSolverStatsDetail(stats);
+    }
+}
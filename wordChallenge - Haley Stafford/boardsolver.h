@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "lexicon.h"
+#include "set.h"
+#include "vector.h"
+#include "testing/lettertile.h"
+#include "wordsink.h"
+#include "wordtrie.h"
+
+/* * * * * * BOARD SOLVER ENGINE * * * * * */
+
+/** Largest number of tiles a board can hold. A full gameboard has 25 tiles
+ * (16 outer, 8 middle, 1 inner), so every set of available tiles fits in
+ * a single 32-bit mask.
+ */
+const int MAX_TILES = 32;
+
+/** Shortest and longest words the game accepts. */
+const int MIN_WORD_LENGTH = 4;
+const int MAX_WORD_LENGTH = 8;
+
+/**
+ * Type representing a gameboard laid out for the solver. Tile i of the board
+ * is bit i of every mask, so the tiles still available during the search are
+ * a single uint32_t rather than a Set<LetterTile>.
+ */
+struct TileBoard {
+    int numTiles;                       /// number of tiles on the board
+    CompactTile tiles[MAX_TILES];       /// letter, depth and value of each tile
+    uint32_t sameOrDeeper[MAX_TILES];   /// mask of tiles at least as deep as each tile
+    uint32_t sameTileBefore[MAX_TILES]; /// mask of lower-numbered tiles with the same letter and depth
+    uint32_t tilesOfLetter[26];         /// mask of the tiles of each letter, 'a' first
+    uint32_t allTiles;                  /// mask with one bit set for every tile
+};
+
+/**
+ * Given a Set of LetterTiles or an array of CompactTiles, returns the TileBoard
+ * holding the same tiles. Raises an error if there are more than MAX_TILES tiles.
+ */
+TileBoard makeTileBoard(const Set<LetterTile>& tiles);
+TileBoard makeTileBoard(const CompactTile* tiles, int numTiles);
+
+/**
+ * Given the letters of the outer, middle and inner rings, returns the TileBoard
+ * of the gameboard, numbering the tiles of each ring from 1 like
+ * stringToLetterTile(). Letters are lowercased. Raises an error if a ring holds
+ * anything but letters or the board has more than MAX_TILES tiles.
+ */
+TileBoard makeRingBoard(const std::string& outer, const std::string& middle, const std::string& inner);
+
+/**
+ * Given a TileBoard, returns the mask of tiles still available after choosing
+ * 'tile' from 'available'. This is the mask version of updateAvailableTiles():
+ * the chosen tile and every tile shallower than it are removed.
+ */
+inline uint32_t tilesAfterChoosing(const TileBoard& board, uint32_t available, int tile) {
+    return available & ~(uint32_t(1) << tile) & board.sameOrDeeper[tile];
+}
+
+/** Smallest board that SolverEngine::AUTOMATIC solves by scanning the dictionary
+ * rather than searching the tiles. Taken from the "Tree search against word scan
+ * by board size" benchmark, one thread, EnglishWords.txt, microseconds per board:
+ *
+ *    tiles              4     8    12    16    20    22    23    24    25
+ *    tree search      0.4   4.8    20    53   129   193   256   372   405
+ *    with prefilter    54    58   135   148   289   398   417   616   714
+ *    word scan         33    35    56    91   161   225   242   276   373
+ */
+const int WORD_SCAN_MIN_TILES = 23;
+
+/**
+ * Type representing the ways of solving a board. Both find the same words.
+ */
+enum class SolverEngine {
+    AUTOMATIC,     /// WORD_SCAN for boards of at least WORD_SCAN_MIN_TILES tiles, TREE_SEARCH otherwise
+    TREE_SEARCH,   /// backtracking search over the tiles, walking the dictionary trie alongside
+    WORD_SCAN      /// check every dictionary word against the board, see scanDictionary(); splits the words across threads
+};
+
+/**
+ * Type representing the choices a caller can make about how a board is solved.
+ * Every combination finds the same words.
+ */
+struct SolverOptions {
+    bool prefilter = false;  /// search a per-board dictionary of only the words whose letters fit the board;
+                             /// building it costs more than the search saves, so it is off by default
+    int threads = 1;         /// worker threads to split the search across; 0 means one per core
+    bool collapseDuplicates = true;   /// expand each distinct (letter, depth) of the available tiles once
+    bool reuseStates = true;          /// skip (prefix, available tiles) states already searched by another path
+    SolverEngine engine = SolverEngine::AUTOMATIC;   /// the scoring search always uses TREE_SEARCH
+};
+
+/**
+ * Sends to 'sink' every word in the dictionary between MIN_WORD_LENGTH and
+ * MAX_WORD_LENGTH letters long that can be spelled from the tiles of 'board'
+ * following the depth rule of updateAvailableTiles(). Each word is sent once,
+ * on the calling thread. The Set versions add the words to 'validWords', and
+ * the Lexicon versions solve against the WordTrie returned by trieForLexicon().
+ */
+void solveBoard(const TileBoard& board, const WordTrie& trie, WordSink& sink,
+                const SolverOptions& options = SolverOptions());
+void solveBoard(const TileBoard& board, const Lexicon& lex, WordSink& sink,
+                const SolverOptions& options = SolverOptions());
+void solveBoard(const TileBoard& board, const WordTrie& trie, Set<std::string>& validWords,
+                const SolverOptions& options = SolverOptions());
+void solveBoard(const TileBoard& board, const Lexicon& lex, Set<std::string>& validWords,
+                const SolverOptions& options = SolverOptions());
+
+/**
+ * Type representing one word found by findTopScoringWords(), along with the
+ * tiles that spell it for the highest score and that score, which is the sum
+ * of the tiles' values.
+ */
+struct ScoredWord {
+    std::string word;             /// the word
+    int score;                    /// sum of the values of the tiles in 'path'
+    Vector<LetterTile> path;      /// tiles spelling the word, first letter first
+};
+
+/**
+ * Returns the 'k' highest-scoring words that solveBoard() would find on 'board',
+ * each with the tile path that earns its highest score, from best to worst.
+ * Words with equal scores are listed alphabetically, so the result does not
+ * depend on the options. Returns fewer than 'k' words if the board spells
+ * fewer.
+ */
+Vector<ScoredWord> findTopScoringWords(const TileBoard& board, const WordTrie& trie, int k,
+                                       const SolverOptions& options = SolverOptions());
+Vector<ScoredWord> findTopScoringWords(const TileBoard& board, const Lexicon& lex, int k,
+                                       const SolverOptions& options = SolverOptions());
+
+/**
+ * Type representing what the search did during a solve. The counters are only
+ * kept when the program is built with SOLVER_STATS defined; otherwise the code
+ * that updates them is compiled out and every counter stays 0.
+ */
+struct SolverStats {
+    long long nodesExpanded = 0;                       /// prefixes the search extended tile by tile
+    long long prefixHits = 0;                          /// extensions that some word begins with
+    long long prefixMisses = 0;                        /// extensions no word begins with
+    long long prunedAtDepth[MAX_WORD_LENGTH + 1] = {}; /// misses by length of the rejected prefix
+    long long wordsEmitted = 0;                        /// distinct words sent to the sink
+    long long statesReused = 0;                        /// extensions skipped as already searched
+    long long wordsScanned = 0;                        /// dictionary words the word scan checked
+    long long signatureMatches = 0;                    /// scanned words whose letters fit the board
+    int maxDepth = 0;                                  /// longest prefix the search reached
+
+    SolverStats& operator+=(const SolverStats& other);
+};
+
+/** Whether this build keeps SolverStats. */
+#ifdef SOLVER_STATS
+const bool SOLVER_STATS_ENABLED = true;
+#else
+const bool SOLVER_STATS_ENABLED = false;
+#endif
+
+/**
+ * Returns the SolverStats of the most recent solveBoard() call on the calling
+ * thread, covering the work of every worker thread it used.
+ */
+SolverStats lastSolverStats();
+
+/**
+ * Adds a summary of 'stats' to the details of the running SimpleTest case
+ * through addDetail().
+ */
+void addSolverStatsDetail(const SolverStats& stats);
+
+/**
+ * Returns a WordTrie holding the words of 'lex'. The last few tries are cached
+ * and reused for as long as the same Lexicon object is passed in unchanged, so
+ * only the first solve against a dictionary pays for building it. Every copy
+ * of a Lexicon is a new dictionary to the cache.
+ */
+std::shared_ptr<const WordTrie> trieForLexicon(const Lexicon& lex);
@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include "console.h"
+#include "batchsolver.h"
 #include "testing/SimpleTest.h"
 #include "vector.h"
 using namespace std;
@@ -14,6 +15,9 @@ using namespace std;
  * This sample main brings up testing menu.
  */
 int main() {
+    if (runBatchModeIfRequested()) {
+        return 0;
+    }
     if (runSimpleTests(SELECTED_TESTS)) {
         return 0;
     }
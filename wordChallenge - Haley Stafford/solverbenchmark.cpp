@@ -0,0 +1,343 @@
+#include "solverbenchmark.h"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "boardsolver.h"
+#include "testing/MemoryDiagnostics.h"
+using namespace std;
+
+/** The nextRandom() function steps a splitmix64 generator. It is used instead
+ * of the standard distributions, whose output differs between libraries, so a
+ * seed names the same corpus everywhere.
+ */
+static uint64_t nextRandom(uint64_t& state){
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/** Relative frequency of each letter 'a' through 'z' in English text, per 1000 letters. */
+static const int ENGLISH_WEIGHTS[26] = {
+/*   a   b   c   d    e   f   g   h   i  j  k   l   m   n   o   p  q   r   s   t   u   v   w  x   y  z */
+    82, 15, 28, 43, 127, 22, 20, 61, 70, 2, 8, 40, 24, 67, 75, 19, 1, 60, 63, 91, 28, 10, 24, 2, 20, 1
+};
+
+/** The letterWeights() function fills in the weight of each letter under
+ * distribution 0 (uniform), 1 (English) or 2 (English with vowels tripled).
+ */
+static void letterWeights(int distribution, int weights[26]){
+    for (int i = 0; i < 26; i++){
+        weights[i] = distribution == 0 ? 1 : ENGLISH_WEIGHTS[i];
+        if (distribution == 2 && string("aeiou").find(char('a' + i)) != string::npos){
+            weights[i] *= 3;
+        }
+    }
+}
+
+/** The randomLetters() function draws 'count' letters with the given weights. */
+static string randomLetters(uint64_t& state, const int weights[26], int count){
+    int total = 0;
+    for (int i = 0; i < 26; i++) total += weights[i];
+    string letters;
+    for (int i = 0; i < count; i++){
+        int pick = int(nextRandom(state) % uint64_t(total));
+        int letter = 0;
+        while (pick >= weights[letter]){
+            pick -= weights[letter];
+            letter++;
+        }
+        letters += char('a' + letter);
+    }
+    return letters;
+}
+
+/** The generateBoardCorpus() function splits each board's tiles between the
+ * rings in roughly the 16:8:1 proportions of a full gameboard, so small boards
+ * still exercise the depth rule.
+ */
+vector<Set<LetterTile>> generateBoardCorpus(uint64_t seed, int boardsPerShape){
+    vector<Set<LetterTile>> corpus;
+    uint64_t state = seed;
+    for (int distribution = 0; distribution < 3; distribution++){
+        int weights[26];
+        letterWeights(distribution, weights);
+        for (int numTiles = 1; numTiles <= 25; numTiles++){
+            int inner = numTiles >= 3 ? 1 : 0;
+            int middle = min(8, (numTiles - inner) / 3);
+            int outer = numTiles - inner - middle;
+            if (outer > 16){
+                middle += outer - 16;
+                outer = 16;
+            }
+            for (int i = 0; i < boardsPerShape; i++){
+                corpus.push_back(stringToLetterTile(randomLetters(state, weights, outer), 1) +
+                                 stringToLetterTile(randomLetters(state, weights, middle), 2) +
+                                 stringToLetterTile(randomLetters(state, weights, inner), 3));
+            }
+        }
+    }
+    return corpus;
+}
+
+/** The runSolverBenchmark() function times the corpus first, which also warms
+ * up the caches the solver keeps per dictionary, and then makes one more pass
+ * to count words and allocations, adding up the SolverStats of each solve to
+ * count nodes. A node is a prefix the tree search expanded or a word the word
+ * scan checked, whichever engine findAllWords() picked for the board. Builds
+ * that do not count every allocation report -1 allocations, and builds without
+ * SOLVER_STATS report -1 nodes.
+ */
+SolverBenchmarkReport runSolverBenchmark(const vector<Set<LetterTile>>& corpus, const WordTrie& trie,
+                                         const BenchmarkOptions& options){
+    SolverBenchmarkReport report;
+    report.boards = int(corpus.size());
+    BenchmarkStats stats = measureOperation([&]() {
+        for (const Set<LetterTile>& tiles: corpus){
+            findAllWords(trie, tiles);
+        }
+    }, options);
+
+    long long allocationsBefore = MemoryDiagnostics::allocationCount();
+    SolverStats solved;
+    for (const Set<LetterTile>& tiles: corpus){
+        report.words += findAllWords(trie, tiles).size();
+        solved += lastSolverStats();
+    }
+    report.allocations = MemoryDiagnostics::COUNTS_ALL_ALLOCATIONS ?
+                         MemoryDiagnostics::allocationCount() - allocationsBefore : -1;
+    report.nodes = SOLVER_STATS_ENABLED ? solved.nodesExpanded + solved.wordsScanned : -1;
+
+    report.passes = stats.iterations;
+    report.secondsPerPass = stats.medianNs / 1e9;
+    report.boardsPerSecond = report.boards / report.secondsPerPass;
+    report.nsPerNode = report.nodes < 0 ? -1 :
+                       report.nodes > 0 ? stats.medianNs / report.nodes : 0;
+    report.allocationsPerBoard = report.allocations < 0 ? -1 :
+                                 report.boards > 0 ? double(report.allocations) / report.boards : 0;
+    return report;
+}
+
+void writeBenchmarkReport(ostream& out, const SolverBenchmarkReport& report){
+    out << "{" << endl
+        << "  \"boards\": " << report.boards << "," << endl
+        << "  \"words\": " << report.words << "," << endl
+        << "  \"nodes\": " << report.nodes << "," << endl
+        << "  \"allocations\": " << report.allocations << "," << endl
+        << "  \"passes\": " << report.passes << "," << endl
+        << "  \"seconds_per_pass\": " << setprecision(9) << report.secondsPerPass << "," << endl
+        << "  \"boards_per_second\": " << report.boardsPerSecond << "," << endl
+        << "  \"ns_per_node\": " << report.nsPerNode << "," << endl
+        << "  \"allocations_per_board\": " << report.allocationsPerBoard << endl
+        << "}" << endl;
+}
+
+/** The readBenchmarkReport() function reads every "key": number pair in the
+ * input, so it accepts anything writeBenchmarkReport() writes regardless of
+ * layout, and then fills in the report from the keys it knows.
+ */
+bool readBenchmarkReport(istream& in, SolverBenchmarkReport& report){
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    map<string, double> fields;
+    size_t position = 0;
+    while ((position = text.find('"', position)) != string::npos){
+        size_t end = text.find('"', position + 1);
+        if (end == string::npos) break;
+        string key = text.substr(position + 1, end - position - 1);
+        size_t colon = text.find_first_not_of(" \t\r\n", end + 1);
+        position = end + 1;
+        if (colon == string::npos || text[colon] != ':') continue;
+        istringstream value(text.substr(colon + 1));
+        double number;
+        if (value >> number) fields[key] = number;
+    }
+    const char* keys[] = {"boards", "words", "nodes", "allocations", "passes", "seconds_per_pass",
+                          "boards_per_second", "ns_per_node", "allocations_per_board"};
+    for (const char* key: keys){
+        if (!fields.count(key)) return false;
+    }
+    report.boards = int(fields["boards"]);
+    report.words = (long long)(fields["words"]);
+    report.nodes = (long long)(fields["nodes"]);
+    report.allocations = (long long)(fields["allocations"]);
+    report.passes = int(fields["passes"]);
+    report.secondsPerPass = fields["seconds_per_pass"];
+    report.boardsPerSecond = fields["boards_per_second"];
+    report.nsPerNode = fields["ns_per_node"];
+    report.allocationsPerBoard = fields["allocations_per_board"];
+    return true;
+}
+
+string findBenchmarkRegressions(const SolverBenchmarkReport& current,
+                                const SolverBenchmarkReport& baseline, double tolerance){
+    ostringstream out;
+    if (current.boards != baseline.boards || current.words != baseline.words){
+        out << "baseline was measured on a different corpus or dictionary ("
+            << baseline.boards << " boards, " << baseline.words << " words vs "
+            << current.boards << " boards, " << current.words << " words)" << endl;
+        return out.str();
+    }
+    if (current.boardsPerSecond < baseline.boardsPerSecond * (1 - tolerance)){
+        out << "throughput fell from " << baseline.boardsPerSecond << " to "
+            << current.boardsPerSecond << " boards/sec" << endl;
+    }
+    bool bothCounted = current.allocations >= 0 && baseline.allocations >= 0;
+    if (bothCounted && current.allocationsPerBoard > baseline.allocationsPerBoard * (1 + tolerance)){
+        out << "allocations rose from " << baseline.allocationsPerBoard << " to "
+            << current.allocationsPerBoard << " per board" << endl;
+    }
+    return out.str();
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Test helper function to print a whole corpus, since LetterTile has no == */
+static string corpusText(const vector<Set<LetterTile>>& corpus){
+    ostringstream out;
+    for (const Set<LetterTile>& tiles: corpus){
+        out << tiles << endl;
+    }
+    return out.str();
+}
+
+STUDENT_TEST("generateBoardCorpus is reproducible and covers every board size"){
+    vector<Set<LetterTile>> corpus = generateBoardCorpus(BENCHMARK_SEED, 2);
+    EXPECT_EQUAL(corpus.size(), 3u * 25 * 2);
+    EXPECT_EQUAL(corpusText(corpus), corpusText(generateBoardCorpus(BENCHMARK_SEED, 2)));
+    EXPECT(corpusText(corpus) != corpusText(generateBoardCorpus(BENCHMARK_SEED + 1, 2)));
+    for (size_t i = 0; i < corpus.size(); i++){
+        int numTiles = int(i / 2 % 25) + 1;
+        EXPECT_EQUAL(corpus[i].size(), numTiles);
+    }
+    int depths[4] = {0, 0, 0, 0};
+    for (const LetterTile& tile: corpus.back()){
+        depths[tile.depth]++;
+    }
+    EXPECT_EQUAL(depths[1], 16);
+    EXPECT_EQUAL(depths[2], 8);
+    EXPECT_EQUAL(depths[3], 1);
+}
+
+STUDENT_TEST("Benchmark reports round-trip and flag regressions"){
+    SolverBenchmarkReport baseline;
+    baseline.boards = 600;
+    baseline.words = 12345;
+    baseline.boardsPerSecond = 1000;
+    baseline.allocationsPerBoard = 40;
+    stringstream file;
+    writeBenchmarkReport(file, baseline);
+    SolverBenchmarkReport read;
+    EXPECT(readBenchmarkReport(file, read));
+    EXPECT_EQUAL(read.words, baseline.words);
+    EXPECT_EQUAL(read.boardsPerSecond, baseline.boardsPerSecond);
+
+    SolverBenchmarkReport current = baseline;
+    current.boardsPerSecond = 950;
+    EXPECT_EQUAL(findBenchmarkRegressions(current, baseline, 0.1), "");
+    current.boardsPerSecond = 850;
+    current.allocationsPerBoard = 50;
+    EXPECT_EQUAL(findBenchmarkRegressions(current, baseline, 0.1),
+                 "throughput fell from 1000 to 850 boards/sec\nallocations rose from 40 to 50 per board\n");
+    current.boardsPerSecond = 1000;
+    current.allocations = -1;
+    current.allocationsPerBoard = -1;
+    EXPECT_EQUAL(findBenchmarkRegressions(current, baseline, 0.1), "");
+    EXPECT_EQUAL(findBenchmarkRegressions(baseline, current, 0.1), "");
+    current = baseline;
+    current.words++;
+    EXPECT(findBenchmarkRegressions(current, baseline, 0.1) != "");
+
+    istringstream truncated("{ \"boards\": 600 }");
+    EXPECT(!readBenchmarkReport(truncated, read));
+}
+
+/*
+ * Solves the benchmark corpus, writes the results to benchmark-report.json and
+ * compares them with benchmark-baseline.json. The baseline belongs to the machine
+ * it was measured on, so it is not checked in; run once with
+ * WORDCHALLENGE_RECORD_BASELINE set to record this run as the baseline. Without
+ * a baseline the test only reports the numbers, and says so in its details, so
+ * a fresh checkout passes. The allowed slowdown is 15% unless WORDCHALLENGE_BENCHMARK_TOLERANCE says otherwise. */
+
+BENCHMARK_TEST("Solver benchmark corpus against the stored baseline"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    vector<Set<LetterTile>> corpus = generateBoardCorpus(BENCHMARK_SEED, BENCHMARK_BOARDS_PER_SHAPE);
+    SolverBenchmarkReport report = runSolverBenchmark(corpus, trie);
+    ofstream reportFile("benchmark-report.json");
+    writeBenchmarkReport(reportFile, report);
+
+    ostringstream summary;
+    summary << report.boards << " boards: " << fixed << setprecision(1) << report.boardsPerSecond
+            << " boards/sec, " << setprecision(2) << report.nsPerNode << " ns/node, "
+            << report.allocationsPerBoard << " allocations/board";
+    addDetail(summary.str());
+
+    if (getenv("WORDCHALLENGE_RECORD_BASELINE") != nullptr){
+        ofstream newBaseline("benchmark-baseline.json");
+        writeBenchmarkReport(newBaseline, report);
+        addDetail("Recorded this run as benchmark-baseline.json");
+        return;
+    }
+    ifstream baselineFile("benchmark-baseline.json");
+    if (!baselineFile.is_open()){
+        addDetail("No benchmark-baseline.json, nothing to compare against; "
+                  "run with WORDCHALLENGE_RECORD_BASELINE set to record one");
+        return;
+    }
+    SolverBenchmarkReport baseline;
+    EXPECT(readBenchmarkReport(baselineFile, baseline));
+    const char* toleranceSetting = getenv("WORDCHALLENGE_BENCHMARK_TOLERANCE");
+    double tolerance = toleranceSetting != nullptr ? atof(toleranceSetting) : 0.15;
+    EXPECT_EQUAL(findBenchmarkRegressions(report, baseline, tolerance), "");
+}
+
+/*
+ * Times the tree search, with and without the prefilter, and the word scan on
+ * the boards of each size in the benchmark corpus, one thread each, to show where
+ * the word scan starts to pay. WORD_SCAN_MIN_TILES in boardsolver.h is set from
+ * this sweep. */
+
+BENCHMARK_TEST("Tree search against word scan by board size"){
+    WordTrie trie = loadWordTrie("EnglishWords.txt");
+    vector<Set<LetterTile>> corpus = generateBoardCorpus(BENCHMARK_SEED, BENCHMARK_BOARDS_PER_SHAPE);
+    trie.signatureIndex();   // build the index the scan and the prefilter share before timing either
+    SolverOptions search, prefiltered, scan;
+    search.engine = SolverEngine::TREE_SEARCH;
+    prefiltered.engine = SolverEngine::TREE_SEARCH;
+    prefiltered.prefilter = true;
+    scan.engine = SolverEngine::WORD_SCAN;
+    BenchmarkOptions timing;
+    timing.maxSeconds = 0.1;
+    for (int numTiles = 4; numTiles <= 25; numTiles++){
+        vector<TileBoard> boards;
+        for (const Set<LetterTile>& tiles: corpus){
+            if (tiles.size() == numTiles) boards.push_back(makeTileBoard(tiles));
+        }
+        double microsPerBoard[3];
+        const SolverOptions* engines[3] = {&search, &prefiltered, &scan};
+        int wordCounts[3];
+        for (int engine = 0; engine < 3; engine++){
+            const SolverOptions& options = *engines[engine];
+            CountingSink words;
+            for (const TileBoard& board: boards) solveBoard(board, trie, words, options);
+            wordCounts[engine] = words.count();
+            BenchmarkStats stats = measureOperation([&]() {
+                CountingSink ignored;
+                for (const TileBoard& board: boards) solveBoard(board, trie, ignored, options);
+            }, timing);
+            microsPerBoard[engine] = stats.medianNs / boards.size() / 1000;
+        }
+        EXPECT_EQUAL(wordCounts[1], wordCounts[0]);
+        EXPECT_EQUAL(wordCounts[2], wordCounts[0]);
+        ostringstream line;
+        line << setw(2) << numTiles << " tiles: tree search " << fixed << setprecision(1)
+             << microsPerBoard[0] << " us/board, prefiltered " << microsPerBoard[1]
+             << " us/board, word scan " << microsPerBoard[2] << " us/board";
+        addDetail(line.str());
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "set.h"
+#include "testing/lettertile.h"
+#include "testing/SimpleTest.h"
+#include "wordtrie.h"
+
+/* * * * * * SOLVER BENCHMARK SUITE * * * * * */
+
+/** Seed of the corpus the stored baseline is measured on. */
+const uint64_t BENCHMARK_SEED = 106;
+
+/** Boards generated for every combination of letter distribution and size. */
+const int BENCHMARK_BOARDS_PER_SHAPE = 8;
+
+/**
+ * Given a seed, returns a corpus of gameboards for benchmarking. For each of
+ * three letter distributions (uniform, English letter frequencies, and English
+ * frequencies with vowels tripled) and each board size from 1 to 25 tiles, it
+ * holds 'boardsPerShape' boards. The same seed always gives the same corpus on
+ * every platform.
+ */
+std::vector<Set<LetterTile>> generateBoardCorpus(uint64_t seed, int boardsPerShape);
+
+/**
+ * Type representing the results of one benchmark run over a corpus.
+ */
+struct SolverBenchmarkReport {
+    int boards = 0;                     /// boards in the corpus
+    long long words = 0;                /// words found over the whole corpus
+    long long nodes = 0;                /// nodes expanded and words scanned by the solver, -1 if not counted
+    long long allocations = 0;          /// heap allocations over the whole corpus, -1 if not counted
+    int passes = 0;                     /// timed passes over the corpus
+    double secondsPerPass = 0;          /// median time of one pass
+    double boardsPerSecond = 0;
+    double nsPerNode = 0;
+    double allocationsPerBoard = 0;
+};
+
+/**
+ * Solves every board of 'corpus' with findAllWords() against 'trie', timing
+ * whole passes over the corpus with measureOperation(), and returns the report.
+ */
+SolverBenchmarkReport runSolverBenchmark(const std::vector<Set<LetterTile>>& corpus, const WordTrie& trie,
+                                         const BenchmarkOptions& options = BenchmarkOptions());
+
+/**
+ * Writes 'report' to 'out' as a flat JSON object, or reads one back from 'in'.
+ * readBenchmarkReport() returns false if a field is missing.
+ */
+void writeBenchmarkReport(std::ostream& out, const SolverBenchmarkReport& report);
+bool readBenchmarkReport(std::istream& in, SolverBenchmarkReport& report);
+
+/**
+ * Compares 'current' against 'baseline' and returns a description of every
+ * regression, or the empty string if there is none. Throughput may drop and
+ * allocations per board may rise by at most 'tolerance' (0.1 means 10%).
+ * Allocations are only compared when both reports counted them. A
+ * baseline measured on a different corpus or dictionary counts as a regression,
+ * since the numbers cannot be compared.
+ */
+std::string findBenchmarkRegressions(const SolverBenchmarkReport& current,
+                                     const SolverBenchmarkReport& baseline, double tolerance);
@@ -9,24 +9,59 @@
 #include "MemoryDiagnostics.h"
 #include "hashmap.h"
 #include "error.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
 #include <sstream>
-#include <unordered_map>
-#include <typeindex>
+#include <vector>
 #include <cxxabi.h> // Nonstandard, but supported on g++ and clang.
+#ifdef _WIN32
+#include <malloc.h>   // _aligned_malloc
+#endif
 using namespace std;
 
 namespace {
-    /* Type --> Frequency */
-    unordered_map<type_index, int>& allocationTable() {
-        static unordered_map<type_index, int> instance;
-        return instance;
-    }
+    /* Every operator new in the program, counted by the replacements below in
+     * builds that have them.
+     */
+    atomic<long long> gAllocationCount(0);
+    atomic<long long> gBytesAllocated(0);
+    atomic<long long> gLiveBytes(0);
+    atomic<long long> gPeakLiveBytes(0);
+
+    /* Readings of the counters above at the last clear(). */
+    long long gCountAtClear = 0, gBytesAtClear = 0, gLiveAtClear = 0;
 
-    /* Name --> Type */
-    unordered_map<string, type_index>& lookupTable() {
-        static unordered_map<string, type_index> instance;
+    /* -1 until first asked, then 0 or 1. */
+    atomic<int> gProfiling(-1);
+
+    /* Slot --> Frequency. A type's slot is fixed when it registers, so recording
+     * an allocation never looks anything up or takes a lock.
+     */
+    atomic<int> gAllocationTable[MemoryDiagnostics::MAX_TRACKED_TYPES];
+
+    /* Slot --> Name, for every type registered so far. Only registration and
+     * typesWithErrors() touch it, under gRegistrationLock.
+     */
+    vector<string>& lookupTable() {
+        static vector<string> instance;
         return instance;
     }
+    mutex gRegistrationLock;
+
+    /* Records of the calling thread, if it has an IsolatedRecords. */
+    thread_local MemoryDiagnostics::IsolatedRecords* tIsolated = nullptr;
+
+    /* Every IsolatedRecords alive, found by id when a block it counted is freed on
+     * another thread. Nothing here allocates, so operator delete may look it up.
+     */
+    const int MAX_LIVE_RECORDS = 256;
+    MemoryDiagnostics::IsolatedRecords* gLiveRecords[MAX_LIVE_RECORDS];
+    unsigned gLastRecordsId = 0;
+    mutex gLiveRecordsLock;
 }
 
 namespace MemoryDiagnostics {
@@ -40,26 +75,82 @@ namespace MemoryDiagnostics {
         auto* realName = abi::__cxa_demangle(type.name(), nullptr, nullptr, &statusCode);
         if (statusCode != 0) error("Internal error: Couldn't demangle name?");
 
-        /* C++ type_info objects don't work well as keys in maps, but std::type_index
-         * allows us to fix that.
-         */
-        lookupTable().insert(make_pair(string(realName), type_index(type)));
-
+        string name(realName);
         free(realName);
-        return 137; // You know, cause, why not?
+
+        /* Hand out the next free slot. */
+        lock_guard<mutex> lock(gRegistrationLock);
+        if (int(lookupTable().size()) == MAX_TRACKED_TYPES) {
+            error("Internal error: Too many tracked types to record " + name);
+        }
+        lookupTable().push_back(name);
+        return int(lookupTable().size()) - 1;
     }
 
-    void recordNew(const type_info& type) {
-        allocationTable()[type_index(type)]++;
+    void recordNew(int slot) {
+        if (tIsolated != nullptr) {
+            tIsolated->typeCounts[slot]++;
+        } else {
+            gAllocationTable[slot].fetch_add(1, memory_order_relaxed);
+        }
     }
 
-    void recordDelete(const type_info& type) {
-        allocationTable()[type_index(type)]--;
+    void recordDelete(int slot) {
+        if (tIsolated != nullptr) {
+            tIsolated->typeCounts[slot]--;
+        } else {
+            gAllocationTable[slot].fetch_sub(1, memory_order_relaxed);
+        }
     }
 
-    /* Clears the allocation table. */
+    /* Clears the allocation table and starts a new allocation profile. */
     void clear() {
-        allocationTable().clear();
+        if (tIsolated != nullptr) {
+            fill(begin(tIsolated->typeCounts), end(tIsolated->typeCounts), 0);
+            tIsolated->allocations = tIsolated->bytesAllocated = 0;
+            tIsolated->liveBytes = 0;
+            tIsolated->peakLiveBytes = 0;
+            return;
+        }
+        for (atomic<int>& record: gAllocationTable) {
+            record.store(0, memory_order_relaxed);
+        }
+        gCountAtClear = gAllocationCount.load(memory_order_relaxed);
+        gBytesAtClear = gBytesAllocated.load(memory_order_relaxed);
+        gLiveAtClear = gLiveBytes.load(memory_order_relaxed);
+        gPeakLiveBytes.store(gLiveAtClear, memory_order_relaxed);
+    }
+
+    long long allocationCount() {
+        return gAllocationCount.load(memory_order_relaxed);
+    }
+
+    AllocationProfile allocationProfile() {
+        AllocationProfile profile;
+        if (tIsolated != nullptr) {
+            profile.allocations = tIsolated->allocations;
+            profile.bytesAllocated = tIsolated->bytesAllocated;
+            profile.peakLiveBytes = tIsolated->peakLiveBytes;
+            profile.liveBytes = tIsolated->liveBytes.load(memory_order_relaxed);
+            return profile;
+        }
+        profile.allocations = gAllocationCount.load(memory_order_relaxed) - gCountAtClear;
+        profile.bytesAllocated = gBytesAllocated.load(memory_order_relaxed) - gBytesAtClear;
+        profile.peakLiveBytes = gPeakLiveBytes.load(memory_order_relaxed) - gLiveAtClear;
+        profile.liveBytes = gLiveBytes.load(memory_order_relaxed) - gLiveAtClear;
+        return profile;
+    }
+
+    bool profilingEnabled() {
+        if (!COUNTS_ALL_ALLOCATIONS) return false;
+        if (gProfiling.load() < 0) {
+            gProfiling = getenv("SIMPLETEST_PROFILE_ALLOCATIONS") != nullptr ? 1 : 0;
+        }
+        return gProfiling.load() == 1;
+    }
+
+    void setProfilingEnabled(bool enabled) {
+        gProfiling = enabled ? 1 : 0;
     }
 
     /* Returns a list of all imbalanced types. */
@@ -67,13 +158,233 @@ namespace MemoryDiagnostics {
         map<string, int> result;
 
         /* Loop over types, looking for mismatches. */
-        for (const auto& entry: lookupTable()) {
-            int record = allocationTable()[entry.second];
+        lock_guard<mutex> lock(gRegistrationLock);
+        for (size_t slot = 0; slot < lookupTable().size(); slot++) {
+            int record = tIsolated != nullptr ? tIsolated->typeCounts[slot]
+                                              : gAllocationTable[slot].load(memory_order_relaxed);
             if (record != 0) {
-                result[entry.first] = record;
+                result[lookupTable()[slot]] = record;
             }
         }
 
         return result;
     }
+
+    /* Ids are never 0, which marks a block counted by no records. If more
+     * records are alive than there are places for, the extra ones are not listed
+     * and only learn of frees made on their own thread.
+     */
+    IsolatedRecords::IsolatedRecords() : liveBytes(0), enclosing(tIsolated) {
+        fill(begin(typeCounts), end(typeCounts), 0);
+        allocations = bytesAllocated = peakLiveBytes = 0;
+        {
+            lock_guard<mutex> guard(gLiveRecordsLock);
+            if (++gLastRecordsId == 0) gLastRecordsId = 1;
+            id = gLastRecordsId;
+            IsolatedRecords** slot = find(begin(gLiveRecords), end(gLiveRecords), nullptr);
+            if (slot != end(gLiveRecords)) *slot = this;
+        }
+        tIsolated = this;
+    }
+
+    IsolatedRecords::~IsolatedRecords() {
+        tIsolated = enclosing;
+        lock_guard<mutex> guard(gLiveRecordsLock);
+        IsolatedRecords** slot = find(begin(gLiveRecords), end(gLiveRecords), this);
+        if (slot != end(gLiveRecords)) *slot = nullptr;
+    }
+}
+
+#ifdef SIMPLETEST_PROFILE_ALLOCATIONS
+
+/* Replacements for the global allocation functions, so allocationCount() and
+ * allocationProfile() see every allocation in the program, including those made
+ * by library containers. Memory comes from malloc as it would from the default
+ * operator new, with a header in front of each block recording its size, so the
+ * delete side knows how many live bytes it gives back, and the id of the
+ * IsolatedRecords that counted it, so a block freed on another thread is given
+ * back to the right records. The header is as large as the strictest alignment
+ * the block needs, so the memory handed out stays suitably aligned.
+ *
+ * Since this changes how every allocation in the program is made, it is only
+ * compiled into builds that define SIMPLETEST_PROFILE_ALLOCATIONS.
+ */
+namespace {
+    struct BlockHeader {
+        size_t bytes;     // size the caller asked for
+        unsigned owner;   // id of the IsolatedRecords that counted the block, or 0
+    };
+
+    const size_t HEADER_BYTES = alignof(max_align_t);
+    static_assert(sizeof(BlockHeader) <= HEADER_BYTES, "the header must fit before an aligned block");
+
+    /* Counts a block of 'bytes' and fills in its header. Returns the memory to
+     * hand out, 'headerBytes' past the start of the block.
+     */
+    void* countAllocation(void* block, size_t bytes, size_t headerBytes) {
+        BlockHeader* header = static_cast<BlockHeader*>(block);
+        header->bytes = bytes;
+        header->owner = 0;
+
+        gAllocationCount.fetch_add(1, memory_order_relaxed);
+        gBytesAllocated.fetch_add(bytes, memory_order_relaxed);
+        long long live = gLiveBytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+        long long peak = gPeakLiveBytes.load(memory_order_relaxed);
+        while (live > peak && !gPeakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+            // peak now holds the latest value; retry until ours is no longer higher
+        }
+        if (MemoryDiagnostics::IsolatedRecords* records = tIsolated) {
+            header->owner = records->id;
+            records->allocations++;
+            records->bytesAllocated += bytes;
+            long long ownLive = records->liveBytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+            records->peakLiveBytes = max(records->peakLiveBytes, ownLive);
+        }
+        return static_cast<char*>(block) + headerBytes;
+    }
+
+    /* Gives back the live bytes of the block holding 'memory', to the records
+     * that counted it even if they belong to another thread. Returns the start
+     * of the block.
+     */
+    void* countDeallocation(void* memory, size_t headerBytes) {
+        void* block = static_cast<char*>(memory) - headerBytes;
+        const BlockHeader* header = static_cast<const BlockHeader*>(block);
+        long long bytes = (long long) header->bytes;
+        gLiveBytes.fetch_sub(bytes, memory_order_relaxed);
+        if (header->owner == 0) return block;
+        if (tIsolated != nullptr && tIsolated->id == header->owner) {
+            tIsolated->liveBytes.fetch_sub(bytes, memory_order_relaxed);
+            return block;
+        }
+        lock_guard<mutex> guard(gLiveRecordsLock);
+        for (MemoryDiagnostics::IsolatedRecords* records: gLiveRecords) {
+            if (records != nullptr && records->id == header->owner) {
+                records->liveBytes.fetch_sub(bytes, memory_order_relaxed);
+                break;
+            }
+        }
+        return block;
+    }
 }
+
+void* operator new(size_t bytes) {
+    void* block = malloc(bytes + HEADER_BYTES);
+    if (block == nullptr) throw bad_alloc();
+    return countAllocation(block, bytes, HEADER_BYTES);
+}
+
+void* operator new[](size_t bytes) {
+    return ::operator new(bytes);
+}
+
+void* operator new(size_t bytes, const nothrow_t&) noexcept {
+    try {
+        return ::operator new(bytes);
+    } catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t bytes, const nothrow_t&) noexcept {
+    return ::operator new(bytes, nothrow);
+}
+
+/* Kept out of line so g++ does not see the free() of a pointer that came from
+ * operator new and warn about a mismatch that the header makes correct.
+ */
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    if (memory == nullptr) return;
+    free(countDeallocation(memory, HEADER_BYTES));
+}
+
+void operator delete[](void* memory) noexcept {
+    ::operator delete(memory);
+}
+
+void operator delete(void* memory, const nothrow_t&) noexcept {
+    ::operator delete(memory);
+}
+
+void operator delete[](void* memory, const nothrow_t&) noexcept {
+    ::operator delete(memory);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* memory, size_t) noexcept {
+    ::operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    ::operator delete(memory);
+}
+#endif
+
+#ifdef __cpp_aligned_new
+/* The over-aligned forms of C++17 keep the same layout, with a header as large
+ * as the alignment so the memory after it stays aligned.
+ */
+static size_t alignedHeaderBytes(align_val_t alignment) {
+    return max(size_t(alignment), HEADER_BYTES);
+}
+
+void* operator new(size_t bytes, align_val_t alignment) {
+    size_t headerBytes = alignedHeaderBytes(alignment);
+#ifdef _WIN32
+    void* block = _aligned_malloc(bytes + headerBytes, size_t(alignment));
+#else
+    void* block = nullptr;
+    if (posix_memalign(&block, size_t(alignment), bytes + headerBytes) != 0) block = nullptr;
+#endif
+    if (block == nullptr) throw bad_alloc();
+    return countAllocation(block, bytes, headerBytes);
+}
+
+void* operator new[](size_t bytes, align_val_t alignment) {
+    return ::operator new(bytes, alignment);
+}
+
+void* operator new(size_t bytes, align_val_t alignment, const nothrow_t&) noexcept {
+    try {
+        return ::operator new(bytes, alignment);
+    } catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t bytes, align_val_t alignment, const nothrow_t&) noexcept {
+    return ::operator new(bytes, alignment, nothrow);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, align_val_t alignment) noexcept {
+    if (memory == nullptr) return;
+    void* block = countDeallocation(memory, alignedHeaderBytes(alignment));
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+void operator delete[](void* memory, align_val_t alignment) noexcept {
+    ::operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, align_val_t alignment, const nothrow_t&) noexcept {
+    ::operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, align_val_t alignment, const nothrow_t&) noexcept {
+    ::operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, align_val_t alignment) noexcept {
+    ::operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, align_val_t alignment) noexcept {
+    ::operator delete(memory, alignment);
+}
+#endif
+
+#endif
@@ -43,9 +43,8 @@
 
 
 #include <typeinfo>
+#include <atomic>
 #include <cstddef>
-#include <typeindex>
-#include <unordered_map>
 #include <string>
 #include <map>
 #include <vector>
@@ -54,17 +53,37 @@
  * functions in your code.
  */
 namespace MemoryDiagnostics {
-    void recordNew(const std::type_info& type);
-    void recordDelete(const std::type_info& type);
+    /* Most distinct types that can be tracked in one program. */
+    const int MAX_TRACKED_TYPES = 256;
+
+    /* Installs the specified type into the main type tables. Returns the counter slot
+     * assigned to the type, which recordNew() and recordDelete() take.
+     */
+    int registerSentinel(const std::type_info& type);
+
+    /* Record one allocation or deallocation of the type in 'slot'. Each is a single
+     * relaxed atomic update, so tracked types may be allocated from any thread.
+     */
+    void recordNew(int slot);
+    void recordDelete(int slot);
 
     template <typename T> struct MemorySentinel {
         static int initializer;
+
+        /* The type's counter slot, assigned the first time it is asked for. */
+        static int slot() {
+            static const int index = registerSentinel(typeid(T));
+            return index;
+        }
     };
 
-    /* Installs the specified type into the main type tables. Returns an integer value
-     * that is completely of no consequence.
-     */
-    int registerSentinel(const std::type_info& type);
+    template <typename T> void recordNew() {
+        recordNew(MemorySentinel<T>::slot());
+    }
+
+    template <typename T> void recordDelete() {
+        recordDelete(MemorySentinel<T>::slot());
+    }
 
     /* Hook to allocate and deallocate memory. Use this to customize how the memory system
      * allocates and deallocates objects of your type.
@@ -90,14 +109,78 @@ namespace MemoryDiagnostics {
     /* Clears all allocation records, effectively resetting the leak counts. */
     void clear();
 
+    /* Whether this build counts every allocation in the program. Doing so means
+     * replacing the global operator new and delete, which changes how all memory
+     * is allocated, so only builds with SIMPLETEST_PROFILE_ALLOCATIONS defined do
+     * it. In other builds allocationCount() stays at 0 and every AllocationProfile
+     * is empty; tracked types are leak checked either way.
+     */
+#ifdef SIMPLETEST_PROFILE_ALLOCATIONS
+    const bool COUNTS_ALL_ALLOCATIONS = true;
+#else
+    const bool COUNTS_ALL_ALLOCATIONS = false;
+#endif
+
+    /* Returns the number of allocations the whole program has made so far through
+     * any form of operator new, whether or not the type is tracked. Take the
+     * difference of two readings to count the allocations made in between.
+     */
+    long long allocationCount();
+
+    /* Type representing the heap use of the program since the last clear(),
+     * counting every allocation whether or not its type is tracked.
+     */
+    struct AllocationProfile {
+        long long allocations;      // calls to operator new
+        long long bytesAllocated;   // bytes requested by those calls
+        long long peakLiveBytes;    // most bytes live at once, above the level at clear()
+        long long liveBytes;        // bytes live now, above the level at clear()
+    };
+
+    /* Returns the AllocationProfile since the last clear(). SimpleTest calls
+     * clear() before each test, so within a test this covers the test so far.
+     */
+    AllocationProfile allocationProfile();
+
+    /* Whether SimpleTest reports each test's AllocationProfile along with its
+     * result. Profiling starts enabled if the SIMPLETEST_PROFILE_ALLOCATIONS
+     * environment variable is set, and is always off unless COUNTS_ALL_ALLOCATIONS.
+     */
+    bool profilingEnabled();
+    void setProfilingEnabled(bool enabled);
+
     /* Returns a map of all types that have memory leaks / errors. Keys are type
      * names, values are allocation records.
      */
     std::map<std::string, int> typesWithErrors();
+
+    /* While an IsolatedRecords lives, the calling thread keeps its own allocation
+     * records: clear(), allocationProfile() and typesWithErrors() on this thread
+     * see only what this thread allocates and frees, and its tracked types are not
+     * counted in the program-wide records. allocationCount() still counts the whole
+     * program. The parallel test runner gives each worker one, so tests running at
+     * the same time do not see each other's allocations. A block freed on another
+     * thread is still given back to the records that counted it.
+     */
+    class IsolatedRecords {
+    public:
+        IsolatedRecords();
+        ~IsolatedRecords();
+        IsolatedRecords(const IsolatedRecords&) = delete;
+        IsolatedRecords& operator=(const IsolatedRecords&) = delete;
+
+        int typeCounts[MAX_TRACKED_TYPES];
+        long long allocations, bytesAllocated, peakLiveBytes;
+        std::atomic<long long> liveBytes;   // lowered by frees on any thread
+        unsigned id;                        // marks the blocks these records counted
+
+    private:
+        IsolatedRecords* enclosing;
+    };
 }
 
 template <typename T>
-int MemoryDiagnostics::MemorySentinel<T>::initializer = registerSentinel(typeid(T));
+int MemoryDiagnostics::MemorySentinel<T>::initializer = MemorySentinel<T>::slot();
 
 /* Implementation of TRACK_ALLOCATIONS introduces operator new/delete hooks that call
  * into the memory diagnostics system.
@@ -110,27 +193,27 @@ int MemoryDiagnostics::MemorySentinel<T>::initializer = registerSentinel(typeid(
 #define TRACK_ALLOCATIONS_OF(Type)                                           \
     void* operator new(std::size_t bytes) {                                  \
         (void) ::MemoryDiagnostics::MemorySentinel<Type>::initializer;       \
-        ::MemoryDiagnostics::recordNew(typeid(Type));                        \
+        ::MemoryDiagnostics::recordNew<Type>();                              \
         return MemoryDiagnostics::Allocator<Type>::scalarAlloc(bytes);       \
     }                                                                        \
     void* operator new[](std::size_t bytes) {                                \
-        ::MemoryDiagnostics::recordNew(typeid(Type));                        \
+        ::MemoryDiagnostics::recordNew<Type>();                              \
         return MemoryDiagnostics::Allocator<Type>::vectorAlloc(bytes);       \
     }                                                                        \
     void operator delete(void* ptr) {                                        \
-        ::MemoryDiagnostics::recordDelete(typeid(Type));                     \
+        ::MemoryDiagnostics::recordDelete<Type>();                           \
         return MemoryDiagnostics::Allocator<Type>::scalarFree(ptr);          \
     }                                                                        \
     void operator delete(void* ptr, std::size_t) {                           \
-        ::MemoryDiagnostics::recordDelete(typeid(Type));                     \
+        ::MemoryDiagnostics::recordDelete<Type>();                           \
         return MemoryDiagnostics::Allocator<Type>::scalarFree(ptr);          \
     }                                                                        \
     void operator delete[](void* ptr) {                                      \
-        ::MemoryDiagnostics::recordDelete(typeid(Type));                     \
+        ::MemoryDiagnostics::recordDelete<Type>();                           \
         return MemoryDiagnostics::Allocator<Type>::vectorFree(ptr);          \
     }                                                                        \
     void operator delete[](void* ptr, std::size_t) {                         \
-        ::MemoryDiagnostics::recordDelete(typeid(Type));                     \
+        ::MemoryDiagnostics::recordDelete<Type>();                           \
         return MemoryDiagnostics::Allocator<Type>::vectorFree(ptr);          \
     }                                                                        \
     static_assert(true, "Just so we need a semicolon.")
@@ -62,6 +62,40 @@
  */
  #define TIME_OPERATION(size, expression) /* Time the evaluation of expression */
 
+/* Time many evaluations of an expression and report statistics in test results.
+ * The expression is first run a few times untimed to warm up caches, then timed
+ * over and over until the mean is known to within a few percent or the time
+ * budget runs out. The report gives the number of timed runs, the min, median,
+ * 95th percentile and standard deviation of a single run, and runs per second.
+ * The argument size is the size of the input.
+ *
+ *    TIME_OPERATION_STATS(myVector.size(), myVector.sort());
+ */
+#define TIME_OPERATION_STATS(size, expression) /* Time repeated evaluations of expression */
+
+/* Defines a test case meant for measuring performance rather than checking
+ * results. It runs like any other test, but is listed in its own BENCHMARK_TEST
+ * group so benchmarks can be run on their own.
+ *
+ *    BENCHMARK_TEST("Description of Benchmark") {
+ *       TIME_OPERATION_STATS(...);
+ *    }
+ */
+#define BENCHMARK_TEST(name) /* Add a new benchmark test case. */
+
+/* Marks a test that must not run alongside other tests, such as one that reads
+ * from the console or starts threads of its own. Put it first in the test. When
+ * the tests are run in parallel, the test is put off until the parallel run is
+ * over and then run on its own; otherwise this does nothing. Benchmark tests
+ * always run on their own.
+ *
+ *    STUDENT_TEST("Description of Test Case") {
+ *       RUN_TEST_SERIALLY();
+ *       ...
+ *    }
+ */
+#define RUN_TEST_SERIALLY() /* Keep this test from running in parallel. */
+
 /* Defines a new test case. You can write whatever code you want inside of the test case,
  * but you'll likely want to use EXPECT and EXPECT_EQUAL in your test cases, as they're
  * what actually perform tests.
@@ -93,7 +127,14 @@ enum Choice { ALL_TESTS, SELECTED_TESTS };
  */
 enum Where { CONSOLE_ONLY, WINDOW_ONLY, CONSOLE_AND_WINDOW };
 
-/* Call this function from your main to run the desired tests.
+/* Call this function from your main to run the desired tests. Tests run one at a
+ * time unless the SIMPLETEST_JOBS environment variable asks for more threads
+ * (0 means one per core), in which case independent tests run in parallel.
+ *
+ * If the SIMPLETEST_REPORT environment variable names a file, no window is opened
+ * and the results are also written to that file for other programs to read: as
+ * JSON if the name ends in .json, and as JUnit XML otherwise. Each test's entry
+ * gives its result, wall time, heap allocations and detail messages.
  */
 bool runSimpleTests(Choice ch, Where where = CONSOLE_AND_WINDOW);
 bool runSimpleTests(std::string groupName, Where where = CONSOLE_AND_WINDOW);
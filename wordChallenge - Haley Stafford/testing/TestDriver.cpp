@@ -9,7 +9,11 @@
  */
 #include "TestDriver.h"
 #include "filelib.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <map>
+#include <vector>
 
 using namespace std;
 
@@ -55,3 +59,73 @@ TestCaseAdder::TestCaseAdder(const TestKey& key, int line, const string& testnam
     gTestsMap()[basename].insert(make_pair(line, tcase));
 }
 
+/* TIME_OPERATION_STATS implementation. The running mean and variance are kept
+ * with Welford's method so the stopping test costs nothing per run; the samples
+ * themselves are kept for the order statistics at the end.
+ */
+BenchmarkStats measureOperation(const std::function<void()>& operation, const BenchmarkOptions& options) {
+    using Clock = chrono::steady_clock;
+    for (int i = 0; i < options.warmups; i++) {
+        operation();
+    }
+
+    vector<double> samples;
+    double mean = 0, sumSquares = 0;
+    bool confident = false;
+    Clock::time_point start = Clock::now();
+    while (int(samples.size()) < max(1, options.maxIterations)) {
+        Clock::time_point before = Clock::now();
+        operation();
+        Clock::time_point after = Clock::now();
+        double ns = chrono::duration<double, nano>(after - before).count();
+        samples.push_back(ns);
+        double delta = ns - mean;
+        mean += delta / samples.size();
+        sumSquares += delta * (ns - mean);
+
+        int n = samples.size();
+        if (n >= max(2, options.minIterations)) {
+            double halfWidth = 1.96 * sqrt(sumSquares / (n - 1) / n);
+            if (halfWidth <= options.targetRelativeError * mean) {
+                confident = true;
+                break;
+            }
+            if (chrono::duration<double>(after - start).count() >= options.maxSeconds) break;
+        }
+    }
+
+    sort(samples.begin(), samples.end());
+    int n = samples.size();
+    BenchmarkStats stats;
+    stats.iterations = n;
+    stats.minNs = samples[0];
+    stats.medianNs = samples[(n - 1) / 2];
+    stats.p95Ns = samples[max(0, int(ceil(0.95 * n)) - 1)];
+    stats.meanNs = mean;
+    stats.stddevNs = n > 1 ? sqrt(sumSquares / (n - 1)) : 0;
+    stats.iterationsPerSecond = mean > 0 ? 1e9 / mean : 0;
+    stats.confident = confident;
+    return stats;
+}
+
+/* Formats a time in nanoseconds in the largest unit that keeps it above 1. */
+static string formatNanoseconds(double ns) {
+    ostringstream out;
+    out << fixed << setprecision(3);
+    if (ns >= 1e9) out << ns / 1e9 << " s";
+    else if (ns >= 1e6) out << ns / 1e6 << " ms";
+    else if (ns >= 1e3) out << ns / 1e3 << " us";
+    else out << ns << " ns";
+    return out.str();
+}
+
+string formatBenchmarkStats(const BenchmarkStats& stats) {
+    ostringstream out;
+    out << stats.iterations << " runs" << (stats.confident ? "" : " (confidence target not met)")
+        << ": min " << formatNanoseconds(stats.minNs)
+        << ", median " << formatNanoseconds(stats.medianNs)
+        << ", p95 " << formatNanoseconds(stats.p95Ns)
+        << ", stddev " << formatNanoseconds(stats.stddevNs)
+        << ", " << fixed << setprecision(1) << stats.iterationsPerSecond << " runs/sec";
+    return out.str();
+}
@@ -47,6 +47,7 @@ public:
 /* First, undefine STUDENT_TEST, since we defined it above as a way of "prototyping" it. */
 #undef STUDENT_TEST
 #undef PROVIDED_TEST
+#undef BENCHMARK_TEST
 
 /* We need several levels of indirection here because of how the preprocessor works.
  * This first layer expands out to the skeleton of what we want.
@@ -55,6 +56,7 @@ public:
 #define PROVIDED_TEST(name) DO_ADD_TEST(_testCase, _adder, name, __LINE__, "PROVIDED_TEST")
 #define AUTOGRADER_TEST(name) DO_ADD_TEST(_testCase, _adder, name, __LINE__, "AUTOGRADER_TEST")
 #define MANUAL_TEST(name) DO_ADD_TEST(_testCase, _adder, name, __LINE__, "MANUAL_TEST")
+#define BENCHMARK_TEST(name) DO_ADD_TEST(_testCase, _adder, name, __LINE__, "BENCHMARK_TEST")
 
 /* This level of indirection exists so that line will be expanded to __LINE__ and
  * from there to the true line number. We still can't token-paste it here, since
@@ -71,6 +73,10 @@ public:
 void reportFailure(const std::string& message, std::size_t line = 0);
 void addDetail(const std::string& message);
 
+#undef RUN_TEST_SERIALLY
+#define RUN_TEST_SERIALLY() requireSerialRun()
+void requireSerialRun();
+
 #undef EXPECT
 #define EXPECT(condition) doExpect(condition, "EXPECT failed: " #condition " is not true.", __LINE__)
 void doExpect(bool condition, const std::string& expression, std::size_t line);
@@ -215,3 +221,40 @@ template <typename T> std::string evaluate(const std::string& orig, const T& ans
     _out << "Line " << __LINE__ << " TIME_OPERATION " << #expr << " (size = " << std::setw(8) << n << ")" << " completed in " << std::setw(8) << std::fixed << std::setprecision(3) << (elapsed_ms/1000) << " secs";\
     addDetail(_out.str());\
 } while(0)
+
+/* * * * Repeated timing for TIME_OPERATION_STATS * * * */
+
+/* Type representing how long to keep timing an operation. Timing stops once at
+ * least minIterations runs are in and the 95% confidence interval of the mean
+ * is within targetRelativeError of the mean, or once maxIterations runs or
+ * maxSeconds of timing are used up, whichever comes first.
+ */
+struct BenchmarkOptions {
+    int warmups = 3;
+    int minIterations = 10;
+    int maxIterations = 100000;
+    double maxSeconds = 1.0;
+    double targetRelativeError = 0.02;
+};
+
+/* Type representing the statistics of the timed runs of an operation. Times
+ * are in nanoseconds per run.
+ */
+struct BenchmarkStats {
+    int iterations;
+    double minNs, medianNs, p95Ns, meanNs, stddevNs;
+    double iterationsPerSecond;
+    bool confident;     // whether the confidence target was met within budget
+};
+
+BenchmarkStats measureOperation(const std::function<void()>& operation,
+                                const BenchmarkOptions& options = BenchmarkOptions());
+std::string formatBenchmarkStats(const BenchmarkStats& stats);
+
+#undef TIME_OPERATION_STATS
+#define TIME_OPERATION_STATS(n, expr) do {\
+    BenchmarkStats _stats = measureOperation([&]() { (void)(expr); });\
+    std::ostringstream _out; \
+    _out << "Line " << __LINE__ << " TIME_OPERATION_STATS " << #expr << " (size = " << std::setw(8) << n << ") " << formatBenchmarkStats(_stats);\
+    addDetail(_out.str());\
+} while(0)
@@ -13,8 +13,14 @@
 #include "gbrowserpane.h"
 #include "gthread.h"
 #include "gwindow.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <map>
+#include <streambuf>
+#include <thread>
 #include "MemoryDiagnostics.h"
 #include <QCoreApplication> // for application name
 #include <QLoggingCategory> // to control log messages
@@ -23,13 +29,66 @@
 #include "SimpleTest.h"
 using namespace std;
 
-static Vector<string> gDetails;
+/* Each test runs start to finish on one thread, so details are kept per thread
+ * and tests running at the same time never mix theirs.
+ */
+static thread_local Vector<string> gDetails;
+
+/* Whether this thread is a worker of the parallel runner. */
+static thread_local bool gInParallelWorker = false;
+
+/* Where this thread's cout output goes while tests run in parallel, or nullptr
+ * to write it through to the console as usual.
+ */
+static thread_local string* gCapturedOutput = nullptr;
+
+/* Stream buffer standing in for cout's while tests run in parallel. It keeps no
+ * buffer of its own, so every write lands straight in the capture of the
+ * thread making it, and the output of tests running at the same time never
+ * interleaves. Threads capturing nothing write through to the original buffer.
+ */
+class CapturingBuffer : public streambuf {
+public:
+    explicit CapturingBuffer(streambuf* original) : original(original) {}
+
+protected:
+    int overflow(int ch) override
+    {
+        if (ch == traits_type::eof()) return traits_type::not_eof(ch);
+        if (gCapturedOutput == nullptr) return original->sputc(char(ch));
+        gCapturedOutput->push_back(char(ch));
+        return ch;
+    }
+
+    streamsize xsputn(const char* text, streamsize count) override
+    {
+        if (gCapturedOutput == nullptr) return original->sputn(text, count);
+        gCapturedOutput->append(text, size_t(count));
+        return count;
+    }
+
+    int sync() override
+    {
+        return gCapturedOutput == nullptr ? original->pubsync() : 0;
+    }
+
+private:
+    streambuf* original;
+};
+
+/* Thrown by requireSerialRun() to hand the test back to the runner. */
+struct SerialRunRequested {};
 
 void addDetail(const string& msg)
 {
     gDetails.add(msg);
 }
 
+void requireSerialRun()
+{
+    if (gInParallelWorker) throw SerialRunRequested();
+}
+
 // hand prototype to avoid having map in exposed header (and leading students astray)
 std::map<TestKey, std::multimap<int, TestCase>>& gTestsMap();
 
@@ -51,6 +110,12 @@ namespace SimpleTest {
         std::function<void()> callback;
         TestResult result;
         string detailMessage;
+        bool serial; // must run on the main thread, never alongside other tests
+        string rowHtml; // how the results pane last showed this test
+        TestResult rowResult;
+        double seconds; // wall time of the last run
+        MemoryDiagnostics::AllocationProfile heap; // heap use of the last run
+        string output; // what the test printed to cout while running in parallel
     };
 
     /* Type representing a group of tests and whether group is selected to run. */
@@ -100,6 +165,7 @@ namespace SimpleTest {
 
     /* Runs a single test. */
     void runSingleTest(Test& test) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
         try {
             /* Reset memory counters so we don't have carryover across tests. */
             MemoryDiagnostics::clear();
@@ -108,6 +174,16 @@ namespace SimpleTest {
             /* Run the test. */
             test.callback();
 
+            /* Report the test's heap use if asked to. */
+            if (MemoryDiagnostics::profilingEnabled()) {
+                MemoryDiagnostics::AllocationProfile profile = MemoryDiagnostics::allocationProfile();
+                ostringstream out;
+                out << "Heap: " << pluralize(profile.allocations, "allocation")
+                    << " totaling " << profile.bytesAllocated << " bytes, peak "
+                    << profile.peakLiveBytes << " bytes live";
+                gDetails.add(out.str());
+            }
+
             /* grab any details accumulated during run */
             test.detailMessage = stringJoin(gDetails, "\n"); // will be overwritten in case of actual failure
 
@@ -133,6 +209,11 @@ namespace SimpleTest {
                 }
                 test.detailMessage += out.str();
             }
+        } catch (const SerialRunRequested&) {
+            /* Leave the test waiting for the serial pass. */
+            test.result = TestResult::WAITING;
+            test.serial = true;
+            return;
         } catch (const TestFailedException& e) {
             test.result = TestResult::FAIL;
             ostringstream out;
@@ -174,6 +255,8 @@ namespace SimpleTest {
             out << endl;
             test.detailMessage = out.str();
         }
+        test.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        test.heap = MemoryDiagnostics::allocationProfile();
         string indented;
         for (auto& line : stringSplit(test.detailMessage, "\n")) {
             indented += "    " + line + "\n";
@@ -181,39 +264,69 @@ namespace SimpleTest {
         test.detailMessage = indented;
     }
 
-    /* Displays all the results from the given test group. */
-    string displayResults(GBrowserPane *bp, const string& stylesheet, const Vector<TestGroup>& testGroups, int npass=-1, int nrun=-1)
+    /* Repaints of the results pane per second while tests are running. */
+    static const int FRAMES_PER_SECOND = 10;
+
+    /* Returns the HTML showing one test. A test's HTML only changes along with its
+     * result, so it is rendered again only when the result differs from the one
+     * it was last rendered for.
+     */
+    const string& testRow(Test& test)
     {
-        stringstream h;
+        if (test.rowHtml.empty() || test.rowResult != test.result) {
+            string li = "<li class=" + quotedVersionOf(info[test.result].id) + ">";
+            test.rowHtml = "<hr>\n" + li + "<b>" + info[test.result].status + "</b> " + test.id + " " + test.testname + "</li>";
+            if (!test.detailMessage.empty()) {
+                test.rowHtml += li + "<pre>" + sanitize(test.detailMessage) + "</pre></li>";
+            }
+            test.rowHtml += "\n";
+            test.rowResult = test.result;
+        }
+        return test.rowHtml;
+    }
+
+    /* Displays all the results from the given test group. A call marks the pane
+     * out of date, and while tests are still running it is repainted at most
+     * FRAMES_PER_SECOND times a second, so the number of repaints, each of which
+     * rebuilds the whole page, stays bounded by time rather than growing with the
+     * number of tests. A call that comes too soon is skipped, but nothing it would
+     * have shown is lost: every row is rendered from the tests' current results,
+     * so the next call that paints shows it. Only the first frame of a run, with
+     * 'immediately' set, and the final call, with the totals, always paint.
+     */
+    string displayResults(GBrowserPane *bp, const string& stylesheet, Vector<TestGroup>& testGroups, int npass=-1, int nrun=-1, bool immediately=false)
+    {
+        static chrono::steady_clock::time_point lastPaint;
         string conclusion;
 
         if (!bp) return affirmation();
 
-        h << "<html><style>" << stylesheet << "</style><body><ul>";
-        for (const auto& group: testGroups) {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (nrun == -1 && !immediately && lastPaint != chrono::steady_clock::time_point()
+                && now - lastPaint < chrono::milliseconds(1000 / FRAMES_PER_SECOND)) {
+            return conclusion;
+        }
+        lastPaint = now;
+
+        string h = "<html><style>" + stylesheet + "</style><body><ul>";
+        for (auto& group: testGroups) {
             if (!group.selected) continue;
-            h << "<li class=" << quotedVersionOf("title") << "> Tests from " << group.name << "</li>" ;
+            h += "<li class=" + quotedVersionOf("title") + "> Tests from " + group.name + "</li>";
             /* Display each test as list item */
-            for (const auto& test: group.tests) {
-                h << "<hr>" << endl;
-                string li = "<li class=" + quotedVersionOf(info[test.result].id) + ">";
-                h << li << "<b>" << info[test.result].status << "</b> " << test.id << " " << test.testname << "</li>";
-                if (!test.detailMessage.empty()) {
-                    h << li << "<pre>" << sanitize(test.detailMessage) << "</pre></li>";
-                }
-                h << endl;
+            for (auto& test: group.tests) {
+                h += testRow(test);
             }
-            h << "<hr>" << endl;
+            h += "<hr>\n";
         }
-        h << "</ul>";
+        h += "</ul>";
         if (nrun > 0) { // all tests completed
-            h << "<h3> Passed " << npass << " of " << nrun << " tests.&nbsp;"; // trailing space after period consumed otherwise
+            h += "<h3> Passed " + to_string(npass) + " of " + to_string(nrun) + " tests.&nbsp;"; // trailing space after period consumed otherwise
             if (npass == nrun) conclusion = affirmation();
-            h << conclusion << "</h3>";
+            h += conclusion + "</h3>";
 
         }
-        h << "</body></html>";
-        bp->setTextPreserveScroll(h.str(), nrun == -1); // patch now incorporated into library
+        h += "</body></html>";
+        bp->setTextPreserveScroll(h, nrun == -1); // patch now incorporated into library
         return conclusion;
     }
 
@@ -236,6 +349,9 @@ namespace SimpleTest {
         }
         t.id = os.str();
         t.result = TestResult::WAITING; // It hasn't run yet
+        t.seconds = 0;
+        t.heap = MemoryDiagnostics::AllocationProfile();
+        t.serial = (tcase.owner == "BENCHMARK_TEST" || tcase.owner == "MANUAL_TEST"); // timed or interactive
         map[groupname].tests += t;
     }
 
@@ -253,12 +369,207 @@ namespace SimpleTest {
         return grouped.values();
     }
 
+    /* Path of the machine-readable report to write, from the SIMPLETEST_REPORT
+     * environment variable, or the empty string if none is wanted.
+     */
+    string requestedReportPath()
+    {
+        const char* path = getenv("SIMPLETEST_REPORT");
+        return path == nullptr ? "" : path;
+    }
+
+    string xmlEscape(const string& s)
+    {
+        string result;
+        for (char ch: s) {
+            switch (ch) {
+                case '&':  result += "&amp;";  break;
+                case '<':  result += "&lt;";   break;
+                case '>':  result += "&gt;";   break;
+                case '"':  result += "&quot;"; break;
+                case '\'': result += "&apos;"; break;
+                default:   result += ch;
+            }
+        }
+        return result;
+    }
+
+    string jsonEscape(const string& s)
+    {
+        ostringstream result;
+        result << '"';
+        for (char ch: s) {
+            switch (ch) {
+                case '"':  result << "\\\""; break;
+                case '\\': result << "\\\\"; break;
+                case '\n': result << "\\n";  break;
+                case '\t': result << "\\t";  break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20) {
+                        result << "\\u" << hex << setw(4) << setfill('0') << int(ch) << dec;
+                    } else {
+                        result << ch;
+                    }
+            }
+        }
+        result << '"';
+        return result.str();
+    }
+
+    /* The test's id without its padding, e.g. "STUDENT_TEST, line  12". */
+    string reportId(const Test& test)
+    {
+        string id = trim(test.id);
+        return id.length() > 2 ? id.substr(1, id.length() - 2) : id;
+    }
+
+    /* Writes the results of the selected groups as JUnit XML, one <testsuite> per
+     * group. Incorrect tests and leaks are failures, exceptions are errors, and
+     * each test's heap use is listed among its properties.
+     */
+    void writeJUnitReport(ostream& out, const Vector<TestGroup>& groups)
+    {
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
+        out << "<testsuites>" << endl;
+        for (const auto& group: groups) {
+            if (!group.selected) continue;
+            int failures = 0, errors = 0;
+            double seconds = 0;
+            for (const auto& test: group.tests) {
+                if (test.result == TestResult::FAIL || test.result == TestResult::LEAK) failures++;
+                if (test.result == TestResult::EXCEPTION) errors++;
+                seconds += test.seconds;
+            }
+            out << "  <testsuite name=\"" << xmlEscape(group.name) << "\" tests=\"" << group.tests.size()
+                << "\" failures=\"" << failures << "\" errors=\"" << errors << "\" time=\"" << seconds << "\">" << endl;
+            for (const auto& test: group.tests) {
+                out << "    <testcase classname=\"" << xmlEscape(group.name) << "\" name=\"" << xmlEscape(test.testname)
+                    << "\" time=\"" << test.seconds << "\">" << endl;
+                out << "      <properties>" << endl;
+                out << "        <property name=\"id\" value=\"" << xmlEscape(reportId(test)) << "\"/>" << endl;
+                out << "        <property name=\"allocations\" value=\"" << test.heap.allocations << "\"/>" << endl;
+                out << "        <property name=\"bytesAllocated\" value=\"" << test.heap.bytesAllocated << "\"/>" << endl;
+                out << "        <property name=\"peakLiveBytes\" value=\"" << test.heap.peakLiveBytes << "\"/>" << endl;
+                out << "      </properties>" << endl;
+                string detail = xmlEscape(test.detailMessage);
+                if (test.result == TestResult::FAIL || test.result == TestResult::LEAK) {
+                    out << "      <failure message=\"" << info[test.result].status << "\">" << detail << "</failure>" << endl;
+                } else if (test.result == TestResult::EXCEPTION) {
+                    out << "      <error message=\"" << info[test.result].status << "\">" << detail << "</error>" << endl;
+                } else if (!test.detailMessage.empty()) {
+                    out << "      <system-out>" << detail << "</system-out>" << endl;
+                }
+                out << "    </testcase>" << endl;
+            }
+            out << "  </testsuite>" << endl;
+        }
+        out << "</testsuites>" << endl;
+    }
+
+    /* Writes the results of the selected groups as one JSON object holding the
+     * totals and an array with an entry for every test run.
+     */
+    void writeJsonReport(ostream& out, const Vector<TestGroup>& groups)
+    {
+        int nrun = 0, npassed = 0;
+        out << "{" << endl << "  \"tests\": [";
+        for (const auto& group: groups) {
+            if (!group.selected) continue;
+            for (const auto& test: group.tests) {
+                out << (nrun == 0 ? "" : ",") << endl;
+                out << "    {\"group\": " << jsonEscape(group.name)
+                    << ", \"name\": " << jsonEscape(test.testname)
+                    << ", \"id\": " << jsonEscape(reportId(test))
+                    << ", \"result\": " << jsonEscape(info[test.result].id)
+                    << ", \"seconds\": " << test.seconds
+                    << ", \"allocations\": " << test.heap.allocations
+                    << ", \"bytesAllocated\": " << test.heap.bytesAllocated
+                    << ", \"peakLiveBytes\": " << test.heap.peakLiveBytes
+                    << ", \"details\": " << jsonEscape(test.detailMessage) << "}";
+                nrun++;
+                if (test.result == TestResult::PASS) npassed++;
+            }
+        }
+        out << endl << "  ]," << endl;
+        out << "  \"run\": " << nrun << "," << endl;
+        out << "  \"passed\": " << npassed << endl;
+        out << "}" << endl;
+    }
+
+    /* Writes the report to 'path', as JSON if the path ends in .json and as
+     * JUnit XML otherwise.
+     */
+    void writeReport(const string& path, const Vector<TestGroup>& groups)
+    {
+        ofstream out(path);
+        if (!out) {
+            cerr << "[SimpleTest] cannot write report to " << path << endl;
+            return;
+        }
+        out << setprecision(6) << fixed;
+        if (endsWith(toLowerCase(path), ".json")) {
+            writeJsonReport(out, groups);
+        } else {
+            writeJUnitReport(out, groups);
+        }
+    }
+
+    /* Number of threads to run tests on, from the SIMPLETEST_JOBS environment
+     * variable: 0 means one per core, and unset means 1, which runs every test in
+     * order on the main thread.
+     */
+    int testJobs()
+    {
+        const char* jobs = getenv("SIMPLETEST_JOBS");
+        if (jobs == nullptr || *jobs == '\0') return 1;
+        int count = atoi(jobs);
+        if (count <= 0) count = thread::hardware_concurrency();
+        return max(count, 1);
+    }
+
+    /* Runs the tests on 'jobs' threads. Each test writes only its own Test, and
+     * each worker keeps its own memory records, so the leak check and heap profile
+     * of a test cover that test alone. What a test prints to cout is kept in its
+     * Test, to be shown when its result is reported in order. A test that asks to
+     * run serially is left waiting, and prints again when it runs.
+     */
+    void runTestsInParallel(const Vector<Test*>& tests, int jobs)
+    {
+        atomic<int> next(0);
+        auto worker = [&]() {
+            MemoryDiagnostics::IsolatedRecords records;
+            gInParallelWorker = true;
+            for (int i = next++; i < tests.size(); i = next++) {
+                Test& test = *tests[i];
+                gCapturedOutput = &test.output;
+                runSingleTest(test);
+                gCapturedOutput = nullptr;
+                if (test.result == TestResult::WAITING) test.output.clear();
+            }
+            gInParallelWorker = false;
+        };
+        cout.flush();
+        streambuf* original = cout.rdbuf();
+        CapturingBuffer capturing(original);
+        cout.rdbuf(&capturing);
+        vector<thread> workers;
+        for (int i = 0; i < min(jobs, tests.size()); i++) {
+            workers.emplace_back(worker);
+        }
+        for (thread& t: workers) {
+            t.join();
+        }
+        cout.rdbuf(original);
+    }
+
     void runSelectedGroups(Vector<TestGroup>& groups, Where where)
     {
         GBrowserPane *bp = nullptr;
         string stylesheet;
         bool displayWindow = (where == CONSOLE_AND_WINDOW || where == WINDOW_ONLY);
         bool displayConsole = (where == CONSOLE_AND_WINDOW || where == CONSOLE_ONLY);
+        string reportPath = requestedReportPath();
+        if (!reportPath.empty()) displayWindow = false; // headless
         ostringstream devnull;
         ostream& console = displayConsole ? cout : devnull;
 
@@ -276,30 +587,54 @@ namespace SimpleTest {
         }
 
         /* Show everything so there's some basic data available. */
-        displayResults(bp, stylesheet, groups);
+        displayResults(bp, stylesheet, groups, -1, -1, true);
+
+        /* With more than one job, first run every test that may run alongside
+         * others on a pool of threads.
+         */
+        int jobs = testJobs();
+        if (jobs > 1) {
+            Vector<Test*> concurrent;
+            for (auto& group: groups) {
+                if (!group.selected) continue;
+                for (auto& test: group.tests) {
+                    if (test.serial) continue;
+                    test.result = TestResult::RUNNING;
+                    concurrent += &test;
+                }
+            }
+            displayResults(bp, stylesheet, groups);
+            runTestsInParallel(concurrent, jobs);
+            displayResults(bp, stylesheet, groups);
+        }
 
         int nrun=0, npassed=0;
         const int test_name_length = 30;
-        /* Now, go run the tests. */
+        /* Now, go run the tests, or report those already run, in order. */
         for (auto& group: groups) {
             if (!group.selected) continue;
             console << endl << "[SimpleTest] ---- Tests from " << group.name << " -----" << endl;
             for (auto& test: group.tests) {
-                /* Make clear that we're running the test. */
-                test.result = TestResult::RUNNING;
-                displayResults(bp,stylesheet, groups);
+                bool alreadyRun = (test.result != TestResult::WAITING);
+                if (!alreadyRun) {
+                    /* Make clear that we're running the test. */
+                    test.result = TestResult::RUNNING;
+                    displayResults(bp, stylesheet, groups);
+                }
                 console << "[SimpleTest] starting" << test.id << left << setfill('.') << setw(test_name_length) << test.testname.substr(0,test_name_length) << "... " << flush;
-                runSingleTest(test);
+                if (!alreadyRun) runSingleTest(test);
+                else cout << test.output << flush;
                 nrun++;
                 if (test.result == TestResult::PASS) npassed++;
                 string status = info[test.result].status;
                 if (!getConsoleEnabled()) status = info[test.result].color + status + NORMAL;
                 console << " =  " << status << endl << test.detailMessage << flush;
-                displayResults(bp, stylesheet, groups);
+                if (!alreadyRun) displayResults(bp, stylesheet, groups);
             }
         }
         string conclusion = displayResults(bp, stylesheet, groups, npassed, nrun);
         console << "You passed " << npassed << " of " << nrun << " tests. " << conclusion << endl << endl;
+        if (!reportPath.empty()) writeReport(reportPath, groups);
         if (npassed < nrun) {
             cout << "Failed tests:" << endl;
             for (const auto& group: groups) {
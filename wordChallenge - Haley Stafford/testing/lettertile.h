@@ -1,9 +1,35 @@
 #pragma once
+#include <cctype>
+#include <cstdint>
 #include "lexicon.h"
 #include "set.h"
 #include <string>
 #include "testing/MemoryDiagnostics.h"
 
+/**
+ * Point multiplier of each lowercase letter 'a' through 'z'. Letters score
+ * 1 (a e i l n o r s), 2 (b c d g h m t), 3 (f k u y), 4 (p v w) or 5 (the rest).
+ */
+constexpr int LETTER_MULTIPLIERS[26] = {
+/*  a  b  c  d  e  f  g  h  i  j  k  l  m  n  o  p  q  r  s  t  u  v  w  x  y  z */
+    1, 2, 2, 2, 1, 3, 2, 2, 1, 5, 3, 1, 2, 1, 1, 4, 5, 1, 1, 2, 3, 4, 4, 5, 3, 5
+};
+
+/**
+ * Returns the point multiplier of a letter. Anything other than a lowercase
+ * letter scores the top multiplier of 5.
+ */
+constexpr int letterMultiplier(char letter) {
+    return (letter >= 'a' && letter <= 'z') ? LETTER_MULTIPLIERS[letter - 'a'] : 5;
+}
+
+/**
+ * Returns the point value of a tile from its letter and ring depth.
+ */
+constexpr int tileValue(char letter, int depth) {
+    return depth + (depth - 1)*letterMultiplier(letter);
+}
+
 /**
  * Type representing a letter tile in the gameboard.
  */
@@ -29,37 +55,60 @@ struct LetterTile {
         depth = layerNumber;
         uniqueID = id;
 
-        int letterMultiplier = 0;
-        Set<std::string> onePoint = {"a","e","i","l","n","o","s","r"};
-        Set<std::string> twoPoint = {"b","g","d","h","c","m","t"};
-        Set<std::string> threePoint = {"f","u","k","y"};
-        Set<std::string> fourPoint = {"v","w","p"};
-        Set<std::string> fivePoint = {"x","z","q"};
-
-        if (onePoint.contains(letter)){
-            letterMultiplier = 1;
-        }
-        else if (twoPoint.contains(letter)){
-            letterMultiplier = 2;
-        }
-        else if (threePoint.contains(letter)){
-            letterMultiplier = 3;
-        }
-        else if (fourPoint.contains(letter)){
-            letterMultiplier = 4;
-        }
-        else {
-            letterMultiplier = 5;
-        }
-
-        value = depth + (depth - 1)*letterMultiplier;
+        value = tileValue(letter.length() == 1 ? letter[0] : '\0', depth);
     }
 };
 
+/**
+ * Compact type representing a letter tile in the gameboard. It holds the same
+ * information as LetterTile in four bytes and never allocates, so boards can be
+ * built and copied in bulk cheaply.
+ *
+ * Ex) CompactTile tile('a', 1, 13);
+ */
+struct CompactTile {
+    char letter;           /// stores tile's lowercase letter
+    uint8_t depth;         /// stores ring depth of tile where 1 = outer, 2 = middle, 3 = inner ring
+    uint8_t uniqueID;      /// stores tile's unique ID to differentiate tiles with the same letter and depth
+    uint8_t value;         /// stores tile's point value which is calculated from letter and depth
+
+    constexpr CompactTile() : letter('\0'), depth(0), uniqueID(0), value(0) {}
+
+    constexpr CompactTile(char singleLetter, int layerNumber, int id)
+        : letter(singleLetter), depth(uint8_t(layerNumber)), uniqueID(uint8_t(id)),
+          value(uint8_t(tileValue(singleLetter, layerNumber))) {}
+};
+
+static_assert(sizeof(CompactTile) == 4, "CompactTile should pack into four bytes");
+
+/**
+ * Converts between LetterTile and CompactTile. Depths and IDs are expected to
+ * fit in a byte, which holds for every ring of the gameboard. The letter is
+ * lowercased on the way to a CompactTile, so its value is scored as lowercase.
+ */
+inline CompactTile toCompactTile(const LetterTile& tile) {
+    char letter = tile.letter.length() == 1 ? char(std::tolower((unsigned char) tile.letter[0])) : '\0';
+    return CompactTile(letter, tile.depth, tile.uniqueID);
+}
+
+inline LetterTile toLetterTile(const CompactTile& tile) {
+    return LetterTile(std::string(1, tile.letter), tile.depth, tile.uniqueID);
+}
+
 /**
  * Allows LetterTile to be comparable and a value of a Set.
  */
-bool operator< (const LetterTile& lhs, const LetterTile& rhs) {
+inline bool operator< (const LetterTile& lhs, const LetterTile& rhs) {
+    using namespace stanfordcpplib::collections;
+    return compareTo(lhs.letter,    rhs.letter,
+                     lhs.depth, rhs.depth,
+                     lhs.uniqueID, rhs.uniqueID) == -1;
+}
+
+/**
+ * Allows CompactTile to be comparable, in the same order as LetterTile.
+ */
+inline bool operator< (const CompactTile& lhs, const CompactTile& rhs) {
     using namespace stanfordcpplib::collections;
     return compareTo(lhs.letter,    rhs.letter,
                      lhs.depth, rhs.depth,
@@ -67,9 +116,10 @@ bool operator< (const LetterTile& lhs, const LetterTile& rhs) {
 }
 
 /**
- * Allows LetterTile to be printed to screen.
+ * Allows LetterTile and CompactTile to be printed to screen.
  */
 std::ostream& operator<< (std::ostream& out, const LetterTile& tile);
+std::ostream& operator<< (std::ostream& out, const CompactTile& tile);
 
 /**
  * Given a string of characters and an integer representing the depth of
@@ -77,7 +127,7 @@ std::ostream& operator<< (std::ostream& out, const LetterTile& tile);
  * containing a single letter character, its depth in the gameboard, and
  * a unique tile ID.
  */
-Set<LetterTile> stringtoLetterTile(std::string s, int depth);
+Set<LetterTile> stringToLetterTile(std::string s, int depth);
 
 /** The getBoardInputs() takes in the user's input for every ring of
  * the game board, prints out the game board, and updates the available
@@ -103,3 +153,14 @@ Set<LetterTile> updateAvailableTiles(Set<LetterTile> availableTiles, LetterTile
 void findAllWordsHelper(Stack<LetterTile> pathway, Set<LetterTile> remainingTiles, std::string curWord, Lexicon& lex, Set<std::string>& validWords);
 
 /* * * * * * SOLUTION TWO * * * * * */
+
+/* * * * * * SOLUTION THREE * * * * * */
+
+class WordTrie;
+
+/** The findAllWords() function returns the Set of every valid word in the
+ * gameboard made up of 'availableTiles', solving against either a Lexicon
+ * (printing the words) or a WordTrie (without printing).
+ */
+Set<std::string> findAllWords(const Lexicon& lex, Set<LetterTile> availableTiles);
+Set<std::string> findAllWords(const WordTrie& trie, Set<LetterTile> availableTiles);
@@ -0,0 +1,35 @@
+/**
+ * File: compiledictionary.cpp
+ *
+ * Build step that compiles a word list into the binary trie image loaded by
+ * loadWordTrie(). It is built on its own from this file and wordtrie.cpp (see
+ * the compile_dictionary target in WordChallenge.pro) and is not part of the
+ * WordChallenge program.
+ *
+ * Usage: compiledictionary [words.txt [words.trie]]
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include "wordtrie.h"
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    string textPath = argc > 1 ? argv[1] : "EnglishWords.txt";
+    string imagePath = argc > 2 ? argv[2] : trieImagePath(textPath);
+
+    vector<string> words;
+    if (!readWordList(textPath, words)) {
+        cerr << "compiledictionary: cannot read " << textPath << endl;
+        return 1;
+    }
+
+    WordTrie trie(words);
+    if (!trie.saveImage(imagePath)) {
+        cerr << "compiledictionary: cannot write " << imagePath << endl;
+        return 1;
+    }
+    cout << "compiledictionary: " << trie.size() << " words, " << trie.nodeCount()
+         << " nodes -> " << imagePath << endl;
+    return 0;
+}
@@ -1,12 +1,15 @@
 #include <iostream>
 #include <string>
+#include <thread>
 #include "console.h"
 #include "testing/lettertile.h"
+#include "boardsolver.h"
 #include "set.h"
 #include "grid.h"
 #include "lexicon.h"
 #include "vector.h"
 #include "simpio.h"
+#include "testing/MemoryDiagnostics.h"
 using namespace std;
 
 /* * * * * * * * * * * * * * * * INTERNAL FUNCTIONS * * * * * * * * * * * * * * * */
@@ -18,6 +21,10 @@ ostream& operator<< (ostream& out, const LetterTile& tile) {
     return out << "[ " << quotedVersionOf(tile.letter) << ", " << tile.depth << ", " << tile.uniqueID << " ]";
 }
 
+ostream& operator<< (ostream& out, const CompactTile& tile) {
+    return out << toLetterTile(tile);
+}
+
 /** The stringToLetterTile() function takes in a string s of letters and an int
  * depth representing the ring layer of those letters where 1 = outer, 2 = middle,
  * and 3 = inner ring. It then returns a vector of LetterTiles where LetterTile.letter
@@ -161,18 +168,19 @@ void getBoardInputs(Set<LetterTile>& availableTiles){
 }
 
 /** The findLongestWords() function takes in a set of words and returns
- * a set containing all of the longest words in the set.
+ * a set containing all of the longest words in the set. It makes a single
+ * pass, adding each word in place rather than building a new Set per word.
  */
-Set<string> findLongestWords(Set<string> allWords){
-    Set<string> longestWords = {""};
-    for (string word:allWords){
-        string curLongest = longestWords.first();
-        if (word.length() > curLongest.length()){
+Set<string> findLongestWords(const Set<string>& allWords){
+    Set<string> longestWords;
+    size_t longestLength = 0;
+    for (const string& word: allWords){
+        if (word.length() > longestLength){
             longestWords.clear();
-            longestWords = longestWords + word;
+            longestLength = word.length();
         }
-        else if (word.length() == curLongest.length()){
-            longestWords = longestWords + word;
+        if (word.length() == longestLength){
+            longestWords.add(word);
         }
     }
     return longestWords;
@@ -244,58 +252,108 @@ Set<LetterTile> updateAvailableTiles(Set<LetterTile> availableTiles, LetterTile
  * be made from the letters in 'remainingTiles' through recursive backtracking
  * and pruning.
  */
-Set<string> findAllWordsHelper(Set<LetterTile> availableTiles, string curWord, Lexicon& lex, Set<string>& validWords){
-    for (LetterTile tile: availableTiles){
-        Set<LetterTile> newRemainingTiles = updateAvailableTiles(availableTiles,tile);
-        string newWord = curWord + tile.letter;
-        if (lex.contains(newWord) && newWord.length() > 3 && newWord.length() < 9){
-            validWords.add(newWord);
-        }
-        if (lex.containsPrefix(newWord) && !newRemainingTiles.isEmpty() && newWord.length() < 8){
-            validWords + findAllWordsHelper(newRemainingTiles, newWord, lex, validWords); // Recursive Case: explore if building valid word
-        }
-    }
-    return validWords;
-}
+// Set<string> findAllWordsHelper(Set<LetterTile> availableTiles, string curWord, Lexicon& lex, Set<string>& validWords){
+//    for (LetterTile tile: availableTiles){
+//        Set<LetterTile> newRemainingTiles = updateAvailableTiles(availableTiles,tile);
+//        string newWord = curWord + tile.letter;
+//        if (lex.contains(newWord) && newWord.length() > 3 && newWord.length() < 9){
+//            validWords.add(newWord);
+//        }
+//        if (lex.containsPrefix(newWord) && !newRemainingTiles.isEmpty() && newWord.length() < 8){
+//            validWords + findAllWordsHelper(newRemainingTiles, newWord, lex, validWords); // Recursive Case: explore if building valid word
+//        }
+//    }
+//    return validWords;
+//}
 
 /** The finalAllWords() function takes in a Lexicon dictionary called 'lex' and
  * a Set of Letter Tiles 'availableTiles', calls the findAllWordsHelper()
  * function, and prints and returns the Set of strings it creates that contains
  * every valid word in the gameboard.
  */
-Set<string> findAllWords(Lexicon& lex, Set<LetterTile> availableTiles){
-    string curWord = "";
+//Set<string> findAllWords(Lexicon& lex, Set<LetterTile> availableTiles){
+//    string curWord = "";
+//    Set<string> validWords;
+//    validWords = findAllWordsHelper(availableTiles, curWord, lex, validWords);
+//    cout << validWords << endl;
+//    return validWords;
+//}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                SOLUTION THREE                                 */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** The findAllWords() function takes in a Lexicon dictionary called 'lex' and
+ * a Set of Letter Tiles 'availableTiles', lays the tiles out as a TileBoard and
+ * hands it to the bitmask solver in boardsolver.cpp, and prints and returns the
+ * Set of strings containing every valid word in the gameboard. The solver
+ * tracks the remaining tiles as a 32-bit mask, so unlike Solution Two no Set of
+ * tiles is copied at any level of the recursion.
+ */
+Set<string> findAllWords(const Lexicon& lex, Set<LetterTile> availableTiles){
     Set<string> validWords;
-    validWords = findAllWordsHelper(availableTiles, curWord, lex, validWords);
+    solveBoard(makeTileBoard(availableTiles), lex, validWords);
     cout << validWords << endl;
     return validWords;
 }
 
+/** This findAllWords() overload solves against a WordTrie, such as the one
+ * loadWordTrie() maps from the compiled dictionary image, and returns the
+ * Set of every valid word in the gameboard without printing it.
+ */
+Set<string> findAllWords(const WordTrie& trie, Set<LetterTile> availableTiles){
+    Set<string> validWords;
+    solveBoard(makeTileBoard(availableTiles), trie, validWords);
+    return validWords;
+}
+
+/** This findLongestWords() overload solves the gameboard straight into a
+ * WordSummarySink, so only the longest words found so far are ever kept and the
+ * Set of every valid word is never built.
+ */
+Set<string> findLongestWords(const WordTrie& trie, Set<LetterTile> availableTiles){
+    WordSummarySink summary;
+    solveBoard(makeTileBoard(availableTiles), trie, summary);
+    return summary.longestWords();
+}
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 /*                                   TEST CASES                                  */
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 /** Copied below copied from Assignment 3 **/
 /*
- * Test helper function to return shared copy of Lexicon. Use to
- * avoid (expensive) re-load of word list on each test case. */
-
-static Lexicon& sharedLexicon() {
-    static Lexicon lex("EnglishWords.txt");
+ * Test helper function to return the shared, read-only Lexicon. Use to
+ * avoid (expensive) re-load of word list on each test case. Bind it to a
+ * const reference rather than copying it: a copy costs a full pass over the
+ * word list, and since the solver reuses its trie only for the very Lexicon
+ * object it was built from, every new copy also makes it build the trie again. */
+
+static const Lexicon& sharedLexicon() {
+    static const Lexicon lex("EnglishWords.txt");
     return lex;
 }
 
+/*
+ * Test helper function to return the shared dictionary trie, mapped from the
+ * compiled EnglishWords.trie image when it is available. */
+
+static const WordTrie& sharedTrie() {
+    static WordTrie trie = loadWordTrie("EnglishWords.txt");
+    return trie;
+}
+
 /** Code above copied from Assignment 3 **/
 
 PROVIDED_TEST("Verify findAllWords functionality, no tiles"){
     Set<LetterTile> availableTiles = {};
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<string> validWords = findAllWords(lex, availableTiles);
     EXPECT_EQUAL(validWords,{});
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("",1);
     Set<LetterTile> middleTiles = stringToLetterTile("WEXXXXXX",2);
     Set<LetterTile> innerTile = stringToLetterTile("R",3);
@@ -305,7 +363,7 @@ PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("AR",1);
     Set<LetterTile> middleTiles = stringToLetterTile("O",2);
     Set<LetterTile> innerTile = stringToLetterTile("R",3);
@@ -315,7 +373,7 @@ PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("ZJQIOOJ",1);
     Set<LetterTile> middleTiles = stringToLetterTile("X",2);
     Set<LetterTile> innerTile = stringToLetterTile("X",3);
@@ -325,7 +383,7 @@ PROVIDED_TEST("Verify findAllWords functionality, no valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, one valid word"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("MOOO",1);
     Set<LetterTile> middleTiles = stringToLetterTile("",2);
     Set<LetterTile> innerTile = stringToLetterTile("N",3);
@@ -335,7 +393,7 @@ PROVIDED_TEST("Verify findAllWords functionality, one valid word"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, seven valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("POR",1);
     Set<LetterTile> middleTiles = stringToLetterTile("WE",2);
     Set<LetterTile> innerTile = stringToLetterTile("R",3);
@@ -346,7 +404,7 @@ PROVIDED_TEST("Verify findAllWords functionality, seven valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, eight valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("qxvtIZxUwzQixzi",1);
     Set<LetterTile> middleTiles = stringToLetterTile("jpquxzd",2);
     Set<LetterTile> innerTile = stringToLetterTile("u",3);
@@ -356,7 +414,7 @@ PROVIDED_TEST("Verify findAllWords functionality, eight valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, 65 valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("qxetIZxUwkQixzr",1);
     Set<LetterTile> middleTiles = stringToLetterTile("jpquxzd",2);
     Set<LetterTile> innerTile = stringToLetterTile("u",3);
@@ -366,7 +424,7 @@ PROVIDED_TEST("Verify findAllWords functionality, 65 valid words"){
 }
 
 PROVIDED_TEST("Verify findAllWords functionality, 400 valid words"){
-    Lexicon lex = sharedLexicon();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> outerTiles = stringToLetterTile("zqwrtuopjikqezxv",1);
     Set<LetterTile> middleTiles = stringToLetterTile("ugztyeio",2);
     Set<LetterTile> innerTile = stringToLetterTile("t",3);
@@ -377,12 +435,143 @@ PROVIDED_TEST("Verify findAllWords functionality, 400 valid words"){
 
 /* Write your STUDENT_TEST functions here */
 
+STUDENT_TEST("CompactTile values match LetterTile values"){
+    static_assert(tileValue('a', 1) == 1 && tileValue('q', 3) == 13, "letter table is compile-time");
+    for (char letter = 'a'; letter <= 'z'; letter++){
+        for (int depth = 1; depth <= 3; depth++){
+            LetterTile tile(charToString(letter), depth, 7);
+            CompactTile compact(letter, depth, 7);
+            EXPECT_EQUAL(compact.value, tile.value);
+            EXPECT_EQUAL(toCompactTile(tile).value, tile.value);
+        }
+    }
+    EXPECT_EQUAL(LetterTile("j", 2, 1).value, 7);
+    EXPECT_EQUAL(LetterTile("Q", 2, 1).value, 7);
+}
+
+STUDENT_TEST("CompactTile round-trips through LetterTile"){
+    for (const LetterTile& tile: stringToLetterTile("POWER", 2)){
+        LetterTile back = toLetterTile(toCompactTile(tile));
+        EXPECT_EQUAL(back.letter, tile.letter);
+        EXPECT_EQUAL(back.depth, tile.depth);
+        EXPECT_EQUAL(back.uniqueID, tile.uniqueID);
+        EXPECT_EQUAL(back.value, tile.value);
+        EXPECT_EQUAL(debugFriendlyString(toCompactTile(tile)), debugFriendlyString(tile));
+    }
+}
+
+STUDENT_TEST("findAllWords gives the same words from the compiled dictionary image"){
+    const WordTrie& trie = sharedTrie();
+    EXPECT_EQUAL(trie.size(), sharedLexicon().size());
+    Set<LetterTile> availableTiles = stringToLetterTile("zqwrtuopjikqezxv",1) +
+            stringToLetterTile("ugztyeio",2) + stringToLetterTile("t",3);
+    EXPECT_EQUAL(findAllWords(trie, availableTiles).size(), 400);
+
+    WordTrie mapped;
+    EXPECT(mapped.mapImage(trieImagePath("EnglishWords.txt")));
+    EXPECT_EQUAL(findAllWords(mapped, availableTiles), findAllWords(trie, availableTiles));
+}
+
+STUDENT_TEST("findLongestWords gives the same words from a Set or straight from the solver"){
+    EXPECT_EQUAL(findLongestWords(Set<string>({"pore", "power", "prow", "rower"})), {"power", "rower"});
+    EXPECT_EQUAL(findLongestWords(Set<string>()), {});
+    Set<LetterTile> availableTiles = stringToLetterTile("zqwrtuopjikqezxv",1) +
+            stringToLetterTile("ugztyeio",2) + stringToLetterTile("t",3);
+    Set<string> longestWords = findLongestWords(sharedTrie(), availableTiles);
+    EXPECT_EQUAL(longestWords, findLongestWords(findAllWords(sharedTrie(), availableTiles)));
+    EXPECT(!longestWords.isEmpty());
+}
+
+STUDENT_TEST("findAllWords stays within its allocation budget"){
+    const WordTrie& trie = sharedTrie();
+    Set<LetterTile> availableTiles = stringToLetterTile("zqwrtuopjikqezxv",1) +
+            stringToLetterTile("ugztyeio",2) + stringToLetterTile("t",3);
+    findAllWords(trie, availableTiles); // build the per-dictionary caches first
+    MemoryDiagnostics::clear();
+    Set<string> validWords = findAllWords(trie, availableTiles);
+    MemoryDiagnostics::AllocationProfile profile = MemoryDiagnostics::allocationProfile();
+    EXPECT_EQUAL(validWords.size(), 400);
+    if (!MemoryDiagnostics::COUNTS_ALL_ALLOCATIONS){
+        addDetail("Allocations are not counted; build with SIMPLETEST_PROFILE_ALLOCATIONS defined to count them");
+        return;
+    }
+    addDetail("findAllWords made " + to_string(profile.allocations) + " allocations, peak " +
+              to_string(profile.peakLiveBytes) + " bytes live");
+    EXPECT(profile.allocations <= 1000);
+    EXPECT(profile.peakLiveBytes <= 256 * 1024);
+}
+
+/*
+ * Node type of a linked search path, tracked by the memory diagnostics. */
+
+struct PathNode {
+    char letter;
+    PathNode* parent;
+    TRACK_ALLOCATIONS_OF(PathNode);
+};
+
+STUDENT_TEST("Tracked nodes are counted correctly from several threads"){
+    RUN_TEST_SERIALLY();
+    const int THREADS = 4, NODES = 2000;
+    vector<vector<PathNode*>> nodes(THREADS);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; t++){
+        threads.emplace_back([&nodes, t](){
+            for (int i = 0; i < NODES; i++){
+                nodes[t].push_back(new PathNode{'a', nullptr});
+            }
+        });
+    }
+    for (thread& worker: threads){
+        worker.join();
+    }
+    EXPECT_EQUAL(MemoryDiagnostics::typesWithErrors()["PathNode"], THREADS * NODES);
+    for (const vector<PathNode*>& list: nodes){
+        for (PathNode* node: list){
+            delete node;
+        }
+    }
+    EXPECT(MemoryDiagnostics::typesWithErrors().empty());
+}
+
+STUDENT_TEST("A block freed on another thread is given back to the thread that counted it"){
+    if (!MemoryDiagnostics::COUNTS_ALL_ALLOCATIONS){
+        addDetail("Allocations are not counted; build with SIMPLETEST_PROFILE_ALLOCATIONS defined to count them");
+        return;
+    }
+    MemoryDiagnostics::IsolatedRecords records;
+    long long liveBefore = records.liveBytes;
+    string* block = new string(1000, 'x');
+    EXPECT(records.liveBytes - liveBefore >= 1000);
+    thread([block](){ delete block; }).join();
+    EXPECT_EQUAL(records.liveBytes - liveBefore, 0);
+}
+
+BENCHMARK_TEST("Time findAllWords on the 400-word board"){
+    const WordTrie& trie = sharedTrie();
+    Set<LetterTile> availableTiles = stringToLetterTile("zqwrtuopjikqezxv",1) +
+            stringToLetterTile("ugztyeio",2) + stringToLetterTile("t",3);
+    TIME_OPERATION_STATS(availableTiles.size(), findAllWords(trie, availableTiles));
+
+    BenchmarkOptions options;
+    options.maxIterations = 50;
+    BenchmarkStats stats = measureOperation([&]() { findAllWords(trie, availableTiles); }, options);
+    EXPECT(stats.iterations >= options.minIterations && stats.iterations <= options.maxIterations);
+    EXPECT(stats.minNs <= stats.medianNs && stats.medianNs <= stats.p95Ns);
+    EXPECT(stats.iterationsPerSecond > 0);
+}
+
 STUDENT_TEST("Allow user to input letter tiles"){
-    Lexicon lex = sharedLexicon();
+    RUN_TEST_SERIALLY();
+    const Lexicon& lex = sharedLexicon();
     Set<LetterTile> availableTiles;
     getBoardInputs(availableTiles);
     Set<string> validWords = findAllWords(lex, availableTiles);
     cout << "Longest Words: " << findLongestWords(validWords) << endl;
+    cout << "Best Scoring Words:" << endl;
+    for (const ScoredWord& scored: findTopScoringWords(makeTileBoard(availableTiles), lex, 5)){
+        cout << "    " << scored.word << " (" << scored.score << " points) " << scored.path << endl;
+    }
 
 
 }
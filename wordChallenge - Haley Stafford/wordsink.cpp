@@ -0,0 +1,70 @@
+#include "wordsink.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/** The addWord() function counts the word under its length. A word longer than
+ * any before it starts a new list of longest words; one of the same length
+ * joins the list.
+ */
+void WordSummarySink::addWord(string&& word){
+    size_t length = word.length();
+    total++;
+    if (length + 1 > lengthCounts.size()){
+        lengthCounts.resize(length + 1, 0);
+        longest.clear();
+    }
+    lengthCounts[length]++;
+    if (length + 1 == lengthCounts.size()){
+        longest.push_back(move(word));
+    }
+}
+
+int WordSummarySink::countOfLength(int length) const {
+    return (length >= 0 && length < int(lengthCounts.size())) ? lengthCounts[length] : 0;
+}
+
+Set<string> WordSummarySink::longestWords() const {
+    Set<string> words;
+    for (const string& word: longest){
+        words.add(word);
+    }
+    return words;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("WordSummarySink tracks the longest words and counts per length"){
+    WordSummarySink summary;
+    EXPECT_EQUAL(summary.longestLength(), 0);
+    EXPECT_EQUAL(summary.longestWords(), {});
+    for (string word: {"pore", "power", "rope", "prower", "roper", "prowed", "prow"}){
+        summary.addWord(move(word));
+    }
+    EXPECT_EQUAL(summary.wordCount(), 7);
+    EXPECT_EQUAL(summary.longestLength(), 6);
+    EXPECT_EQUAL(summary.longestWords(), {"prowed", "prower"});
+    EXPECT_EQUAL(summary.countOfLength(4), 3);
+    EXPECT_EQUAL(summary.countOfLength(5), 2);
+    EXPECT_EQUAL(summary.countOfLength(9), 0);
+}
+
+STUDENT_TEST("Sinks move, collect, forward and count words"){
+    vector<string> inOrder;
+    VectorSink vectorSink(inOrder);
+    unordered_set<string> distinct;
+    HashSetSink hashSink(distinct);
+    vector<string> forwarded;
+    CallbackSink callbackSink([&forwarded](string&& word){ forwarded.push_back(move(word)); });
+    CountingSink counter;
+    for (WordSink* sink: vector<WordSink*>({&vectorSink, &hashSink, &callbackSink, &counter})){
+        for (string word: {"rope", "pore", "rope"}){
+            sink->addWord(move(word));
+        }
+    }
+    EXPECT(inOrder == vector<string>({"rope", "pore", "rope"}));
+    EXPECT(forwarded == inOrder);
+    EXPECT_EQUAL(distinct.size(), 2u);
+    EXPECT_EQUAL(counter.count(), 3);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "set.h"
+
+/* * * * * * WORD SINKS * * * * * */
+
+/**
+ * Type representing where the solver sends the words it finds. The solver hands
+ * each word to addWord() exactly once, as a string the sink may move from, so a
+ * caller decides what to keep rather than always getting a Set of every word.
+ *
+ * Ex) WordSummarySink summary;
+ *     solveBoard(board, trie, summary);
+ *     summary.longestWords();
+ */
+class WordSink {
+public:
+    virtual ~WordSink() {}
+
+    /** Receives one word found by the solver. */
+    virtual void addWord(std::string&& word) = 0;
+};
+
+/**
+ * Sink adding every word to a caller's Set<string>.
+ */
+class SetSink : public WordSink {
+public:
+    explicit SetSink(Set<std::string>& words) : words(words) {}
+    void addWord(std::string&& word) override { words.add(word); }
+
+private:
+    Set<std::string>& words;
+};
+
+/**
+ * Sink moving every word onto the end of a caller's vector, in the order the
+ * solver finds them.
+ */
+class VectorSink : public WordSink {
+public:
+    explicit VectorSink(std::vector<std::string>& words) : words(words) {}
+    void addWord(std::string&& word) override { words.push_back(std::move(word)); }
+
+private:
+    std::vector<std::string>& words;
+};
+
+/**
+ * Sink moving every word into a caller's unordered_set. The solver already sends
+ * each word of a board once, so this is for collecting the distinct words of
+ * several boards without the ordering cost of a Set.
+ */
+class HashSetSink : public WordSink {
+public:
+    explicit HashSetSink(std::unordered_set<std::string>& words) : words(words) {}
+    void addWord(std::string&& word) override { words.insert(std::move(word)); }
+
+private:
+    std::unordered_set<std::string>& words;
+};
+
+/**
+ * Sink passing every word to a function as it is found, for callers that print
+ * or filter words on the fly.
+ *
+ * Ex) CallbackSink sink([](std::string&& word) { cout << word << endl; });
+ */
+class CallbackSink : public WordSink {
+public:
+    typedef std::function<void(std::string&&)> Callback;
+
+    explicit CallbackSink(Callback callback) : callback(std::move(callback)) {}
+    void addWord(std::string&& word) override { callback(std::move(word)); }
+
+private:
+    Callback callback;
+};
+
+/**
+ * Sink counting the words and keeping none of them.
+ */
+class CountingSink : public WordSink {
+public:
+    void addWord(std::string&&) override { total++; }
+
+    /** Number of words received. */
+    int count() const { return total; }
+
+private:
+    int total = 0;
+};
+
+/**
+ * Sink keeping only a summary of the words: how many there are of each length
+ * and which are the longest. Words shorter than the longest seen so far are
+ * counted and dropped, so a solve that only needs the longest words never holds
+ * the rest.
+ */
+class WordSummarySink : public WordSink {
+public:
+    void addWord(std::string&& word) override;
+
+    /** Number of words received. */
+    int wordCount() const { return total; }
+
+    /** Number of words received that are 'length' letters long. */
+    int countOfLength(int length) const;
+
+    /** Length of the longest word received, or 0 if there were none. */
+    int longestLength() const { return lengthCounts.empty() ? 0 : int(lengthCounts.size()) - 1; }
+
+    /** The words of the longest length received. */
+    Set<std::string> longestWords() const;
+
+private:
+    int total = 0;
+    std::vector<int> lengthCounts;      // lengthCounts[n] is the number of words n letters long
+    std::vector<std::string> longest;   // every word of the longest length so far
+};
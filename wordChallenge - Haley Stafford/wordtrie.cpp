@@ -0,0 +1,385 @@
+#include "wordtrie.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+/** The WordTrie constructor cleans up and sorts the words, then lays them out
+ * with layOut().
+ */
+WordTrie::WordTrie(const vector<string>& words)
+    : mapping(nullptr), mappingSize(0), nodes(nullptr), numNodes(0), numWords(0),
+      signatures(new LazySignatureIndex){
+    vector<string> sorted;
+    for (const string& word: words){
+        string lower = word;
+        bool lettersOnly = !lower.empty();
+        for (char& ch: lower){
+            ch = char(tolower((unsigned char) ch));
+            if (ch < 'a' || ch > 'z') lettersOnly = false;
+        }
+        if (lettersOnly) sorted.push_back(lower);
+    }
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+    layOut(sorted);
+}
+
+WordTrie WordTrie::fromSortedWords(const vector<string>& words){
+    WordTrie trie;
+    trie.layOut(words);
+    return trie;
+}
+
+/** The layOut() function lays the sorted words out breadth first. All the
+ * words below a node form a contiguous run of the sorted list, so each node is
+ * built from a run of words and the length of the prefix they share, and its
+ * children are the sub-runs that agree on the next letter. The children of a
+ * node are created one after another, which is what lets a node find any child
+ * from its first child's index and a popcount.
+ */
+void WordTrie::layOut(const vector<string>& sorted){
+    struct Run {
+        size_t begin, end;  // words sorted[begin, end) share their first 'length' letters
+        size_t length;
+    };
+    storage.clear();
+    vector<Run> runs = { {0, sorted.size(), 0} }; // runs[i] becomes storage[i]
+    storage.push_back(TrieNode{0, 0});
+    for (size_t i = 0; i < runs.size(); i++){
+        Run run = runs[i];
+        uint32_t mask = 0;
+        size_t next = run.begin;
+        if (next < run.end && sorted[next].length() == run.length){
+            mask |= TRIE_WORD_BIT; // the shared prefix itself sorts first
+            next++;
+        }
+        storage[i].firstChild = uint32_t(storage.size());
+        while (next < run.end){
+            char letter = sorted[next][run.length];
+            size_t end = next;
+            while (end < run.end && sorted[end][run.length] == letter) end++;
+            mask |= uint32_t(1) << (letter - 'a');
+            runs.push_back(Run{next, end, run.length + 1});
+            storage.push_back(TrieNode{0, 0});
+            next = end;
+        }
+        storage[i].childMask = mask;
+    }
+    nodes = storage.data();
+    numNodes = storage.size();
+    numWords = int(sorted.size());
+}
+
+WordTrie::WordTrie(WordTrie&& other)
+    : mapping(nullptr), mappingSize(0), nodes(nullptr), numNodes(0), numWords(0),
+      signatures(new LazySignatureIndex){
+    *this = std::move(other);
+}
+
+WordTrie& WordTrie::operator=(WordTrie&& other){
+    if (this != &other){
+        release();
+        storage = std::move(other.storage);
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        nodes = other.nodes;
+        numNodes = other.numNodes;
+        numWords = other.numWords;
+        signatures = std::move(other.signatures);
+        other.signatures.reset(new LazySignatureIndex);
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+        other.nodes = nullptr;
+        other.numNodes = 0;
+        other.numWords = 0;
+    }
+    return *this;
+}
+
+WordTrie::~WordTrie(){
+    release();
+}
+
+/** The release() function drops the nodes, unmapping the image if the trie
+ * was loaded by mapImage().
+ */
+void WordTrie::release(){
+#ifndef _WIN32
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    storage.clear();
+    nodes = nullptr;
+    numNodes = 0;
+    numWords = 0;
+}
+
+bool WordTrie::saveImage(const string& path) const {
+    TrieImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRIE_IMAGE_MAGIC, sizeof(header.magic));
+    header.byteOrder = TRIE_IMAGE_BYTE_ORDER;
+    header.version = TRIE_IMAGE_VERSION;
+    header.numWords = uint32_t(numWords);
+    header.numNodes = numNodes;
+
+    /* Write to a temporary name and rename, so a process mapping the image never
+     * sees a half-written file.
+     */
+    string partial = path + ".partial";
+    ofstream out(partial.c_str(), ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodes), streamsize(numNodes * sizeof(TrieNode)));
+    out.close();
+    if (!out){
+        remove(partial.c_str());
+        return false;
+    }
+    return rename(partial.c_str(), path.c_str()) == 0;
+}
+
+/** The validImageHeader() function checks that 'size' bytes starting with
+ * 'header' hold an image this build wrote: right magic number, byte order and
+ * version, and a node array that exactly fills the rest of the file.
+ */
+static bool validImageHeader(const TrieImageHeader& header, size_t size){
+    return memcmp(header.magic, TRIE_IMAGE_MAGIC, sizeof(header.magic)) == 0
+        && header.byteOrder == TRIE_IMAGE_BYTE_ORDER
+        && header.version == TRIE_IMAGE_VERSION
+        && header.numNodes > 0
+        && header.numNodes == (size - sizeof(TrieImageHeader)) / sizeof(TrieNode)
+        && size == sizeof(TrieImageHeader) + header.numNodes * sizeof(TrieNode);
+}
+
+/** The validImageNodes() function checks that every node of an image keeps its
+ * children inside the node array, so that a corrupt or stale image is rejected
+ * when it is mapped rather than read out of bounds by child() later. A node's
+ * children are the popcount of its letter bits starting at firstChild.
+ */
+static bool validImageNodes(const TrieNode* nodes, size_t numNodes){
+    for (size_t i = 0; i < numNodes; i++){
+        uint32_t mask = nodes[i].childMask;
+        if ((mask & ~(TRIE_LETTER_BITS | TRIE_WORD_BIT)) != 0) return false;
+        uint32_t children = uint32_t(__builtin_popcount(mask & TRIE_LETTER_BITS));
+        if (children > 0 && uint64_t(nodes[i].firstChild) + children > numNodes) return false;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+bool WordTrie::mapImage(const string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(TrieImageHeader)){
+        close(fd);
+        return false;
+    }
+    size_t size = size_t(info.st_size);
+    void* image = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid after the descriptor is closed
+    if (image == MAP_FAILED) return false;
+
+    const TrieImageHeader* header = static_cast<const TrieImageHeader*>(image);
+    if (!validImageHeader(*header, size)
+            || !validImageNodes(reinterpret_cast<const TrieNode*>(header + 1), size_t(header->numNodes))){
+        munmap(image, size);
+        return false;
+    }
+    release();
+    mapping = image;
+    mappingSize = size;
+    nodes = reinterpret_cast<const TrieNode*>(header + 1);
+    numNodes = size_t(header->numNodes);
+    numWords = int(header->numWords);
+    signatures.reset(new LazySignatureIndex);
+    return true;
+}
+#else
+/* Windows has no mmap(), so the image is read into memory instead. It still
+ * skips all parsing and trie construction.
+ */
+bool WordTrie::mapImage(const string& path){
+    ifstream in(path.c_str(), ios::binary | ios::ate);
+    if (!in) return false;
+    size_t size = size_t(in.tellg());
+    if (size < sizeof(TrieImageHeader)) return false;
+    in.seekg(0);
+    TrieImageHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || !validImageHeader(header, size)) return false;
+    vector<TrieNode> image(size_t(header.numNodes));
+    in.read(reinterpret_cast<char*>(image.data()), streamsize(image.size() * sizeof(TrieNode)));
+    if (!in || !validImageNodes(image.data(), image.size())) return false;
+    release();
+    storage = std::move(image);
+    nodes = storage.data();
+    numNodes = storage.size();
+    numWords = int(header.numWords);
+    signatures.reset(new LazySignatureIndex);
+    return true;
+}
+#endif
+
+/** The find() function walks 'prefix' down from the root and returns the node
+ * it ends on, or TRIE_NO_NODE if no word begins with it.
+ */
+uint32_t WordTrie::find(const string& prefix) const {
+    if (numNodes == 0) return TRIE_NO_NODE;
+    uint32_t node = root();
+    for (char ch: prefix){
+        node = child(node, char(tolower((unsigned char) ch)));
+        if (node == TRIE_NO_NODE) break;
+    }
+    return node;
+}
+
+bool WordTrie::contains(const string& word) const {
+    uint32_t node = find(word);
+    return node != TRIE_NO_NODE && isWord(node);
+}
+
+bool WordTrie::containsPrefix(const string& prefix) const {
+    uint32_t node = find(prefix);
+    return node != TRIE_NO_NODE && (isWord(node) || hasChildren(node));
+}
+
+bool readWordList(const string& path, vector<string>& words){
+    ifstream in(path.c_str());
+    if (!in) return false;
+    string line;
+    while (getline(in, line)){
+        if (!line.empty() && line[line.length() - 1] == '\r') line.erase(line.length() - 1);
+        words.push_back(line);
+    }
+    return true;
+}
+
+string trieImagePath(const string& textPath){
+    size_t dot = textPath.find_last_of('.');
+    size_t slash = textPath.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)){
+        return textPath + ".trie";
+    }
+    return textPath.substr(0, dot) + ".trie";
+}
+
+/** The loadWordTrie() function prefers the compiled image and falls back to
+ * the word list, one word per line, when the image is missing, older than the
+ * word list, or unreadable.
+ */
+WordTrie loadWordTrie(const string& textPath){
+    string imagePath = trieImagePath(textPath);
+    struct stat textInfo, imageInfo;
+    bool haveText = stat(textPath.c_str(), &textInfo) == 0;
+    bool haveImage = stat(imagePath.c_str(), &imageInfo) == 0;
+    WordTrie trie;
+    if (haveImage && (!haveText || imageInfo.st_mtime >= textInfo.st_mtime) && trie.mapImage(imagePath)){
+        return trie;
+    }
+    vector<string> words;
+    readWordList(textPath, words);
+    trie = WordTrie(words);
+    if (haveText) trie.saveImage(imagePath); // best effort, the directory may be read-only
+    return trie;
+}
+
+#ifndef WORDTRIE_NO_TESTS
+#include "lexicon.h"
+#include "testing/SimpleTest.h"
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("WordTrie answers contains and containsPrefix like Lexicon"){
+    WordTrie trie({"moon", "Moo", "mop", "rope", "roper", "x-ray", ""});
+    EXPECT_EQUAL(trie.size(), 5);
+    EXPECT(trie.contains("moo"));
+    EXPECT(trie.contains("ROPE"));
+    EXPECT(!trie.contains("mo"));
+    EXPECT(!trie.contains("x-ray"));
+    EXPECT(trie.containsPrefix("mo"));
+    EXPECT(trie.containsPrefix(""));
+    EXPECT(trie.containsPrefix("roper"));
+    EXPECT(!trie.containsPrefix("ropes"));
+    EXPECT(!trie.containsPrefix("q"));
+}
+
+STUDENT_TEST("TrieCursor steps one letter at a time"){
+    WordTrie trie({"moo", "moon", "mop"});
+    TrieCursor cursor(trie);
+    EXPECT(cursor.advance('m'));
+    EXPECT(cursor.advance('o'));
+    EXPECT_EQUAL(cursor.childLetters(), (uint32_t(1) << ('o' - 'a')) | (uint32_t(1) << ('p' - 'a')));
+    EXPECT(!cursor.advance('x'));
+    EXPECT(cursor.advance('o'));
+    EXPECT(cursor.isWord());
+    EXPECT(cursor.hasChildren());
+    EXPECT(cursor.advance('n'));
+    EXPECT(cursor.isWord());
+    EXPECT(!cursor.hasChildren());
+}
+
+STUDENT_TEST("WordTrie agrees with the shared dictionary"){
+    Lexicon lex("EnglishWords.txt");
+    WordTrie trie = buildWordTrie(lex);
+    EXPECT_EQUAL(trie.size(), lex.size());
+    for (string word: {"quiz", "zizit", "prower", "epizooty", "aa", "zyzzyva"}){
+        EXPECT(trie.contains(word));
+    }
+    for (string prefix: {"qu", "epizo", "zyzz"}){
+        EXPECT_EQUAL(trie.containsPrefix(prefix), lex.containsPrefix(prefix));
+    }
+    EXPECT(!trie.contains("qzx"));
+}
+
+STUDENT_TEST("WordTrie image round-trips through saveImage and mapImage"){
+    WordTrie trie({"moo", "moon", "mop", "rope"});
+    string path = "wordtrie-test-" + to_string(__LINE__) + ".trie";
+    EXPECT(trie.saveImage(path));
+    WordTrie mapped;
+    EXPECT(mapped.mapImage(path));
+    EXPECT_EQUAL(mapped.size(), 4);
+    EXPECT_EQUAL(mapped.nodeCount(), trie.nodeCount());
+    EXPECT(mapped.contains("moon"));
+    EXPECT(!mapped.contains("mo"));
+    WordTrie moved = std::move(mapped);
+    EXPECT(moved.contains("rope"));
+    EXPECT_EQUAL(mapped.size(), 0);
+    remove(path.c_str());
+}
+
+STUDENT_TEST("mapImage rejects missing and malformed files"){
+    WordTrie trie({"moon"});
+    EXPECT(!trie.mapImage("no-such-file.trie"));
+    string path = "wordtrie-test-" + to_string(__LINE__) + ".trie";
+    ofstream(path.c_str()) << "EnglishWords.txt is not an image";
+    EXPECT(!trie.mapImage(path));
+    EXPECT(trie.contains("moon"));
+
+    /* A well-formed header over a node whose children run past the last node. */
+    WordTrie({"moo", "moon"}).saveImage(path);
+    {
+        fstream image(path.c_str(), ios::binary | ios::in | ios::out);
+        uint32_t firstChild = 1000;
+        image.seekp(streamoff(sizeof(TrieImageHeader) + offsetof(TrieNode, firstChild)));
+        image.write(reinterpret_cast<const char*>(&firstChild), sizeof(firstChild));
+    }
+    EXPECT(!trie.mapImage(path));
+    EXPECT(trie.contains("moon"));
+    remove(path.c_str());
+    EXPECT_EQUAL(trieImagePath("EnglishWords.txt"), "EnglishWords.trie");
+    EXPECT_EQUAL(trieImagePath("dir.d/words"), "dir.d/words.trie");
+}
+#endif // WORDTRIE_NO_TESTS
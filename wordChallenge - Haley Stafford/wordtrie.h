@@ -0,0 +1,213 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct SignatureIndex;
+
+/* * * * * * WORD TRIE * * * * * */
+
+/**
+ * Type representing one node of a WordTrie. The children of a node are stored
+ * next to each other in letter order, so a node only needs the mask of letters
+ * it has children for and the index of its first child.
+ */
+struct TrieNode {
+    uint32_t childMask;    /// bit c is set if the node has a child for letter 'a' + c; bit 31 marks a word
+    uint32_t firstChild;   /// index of the child for the lowest letter in childMask
+};
+
+/** Bits of TrieNode::childMask holding letters and the end-of-word flag. */
+const uint32_t TRIE_LETTER_BITS = (uint32_t(1) << 26) - 1;
+const uint32_t TRIE_WORD_BIT = uint32_t(1) << 31;
+
+/** Index returned when a node has no child for a letter. */
+const uint32_t TRIE_NO_NODE = 0xFFFFFFFF;
+
+/**
+ * Type representing a dictionary stored as a flat array of TrieNodes rooted at
+ * index 0. Unlike Lexicon, it exposes its nodes so a search can step one letter
+ * at a time rather than looking up every prefix from the root.
+ *
+ * A WordTrie can be moved but not copied.
+ */
+class WordTrie {
+public:
+    /** Builds a trie holding every word in 'words'. Words are lowercased, and
+     * words containing anything other than letters are skipped.
+     */
+    explicit WordTrie(const std::vector<std::string>& words = std::vector<std::string>());
+
+    /** Builds a trie from words that are already lowercase, letters only,
+     * sorted and free of duplicates, skipping the copy and sort the constructor
+     * makes.
+     */
+    static WordTrie fromSortedWords(const std::vector<std::string>& words);
+
+    WordTrie(WordTrie&& other);
+    WordTrie& operator=(WordTrie&& other);
+    WordTrie(const WordTrie&) = delete;
+    WordTrie& operator=(const WordTrie&) = delete;
+    ~WordTrie();
+
+    /** Writes the trie to 'path' as a binary image: a TrieImageHeader followed
+     * by the node array exactly as it sits in memory. Returns false if the file
+     * could not be written.
+     */
+    bool saveImage(const std::string& path) const;
+
+    /** Replaces the contents of this trie with the image stored at 'path',
+     * mapping the file read-only rather than reading it, so the nodes are used
+     * in place and shared with every other process that maps the same file.
+     * Returns false and leaves the trie unchanged if the file is missing or is
+     * not an image this build can use.
+     */
+    bool mapImage(const std::string& path);
+
+    /** Index of the root node, which stands for the empty prefix. */
+    uint32_t root() const { return 0; }
+
+    /** Returns the child of 'node' for 'letter', or TRIE_NO_NODE if there is none. */
+    uint32_t child(uint32_t node, char letter) const {
+        unsigned index = unsigned(letter - 'a');
+        if (index >= 26) return TRIE_NO_NODE;
+        uint32_t mask = nodes[node].childMask;
+        uint32_t bit = uint32_t(1) << index;
+        if (!(mask & bit)) return TRIE_NO_NODE;
+        return nodes[node].firstChild + __builtin_popcount(mask & (bit - 1));
+    }
+
+    /** Returns whether the prefix that leads to 'node' is a word. */
+    bool isWord(uint32_t node) const { return (nodes[node].childMask & TRIE_WORD_BIT) != 0; }
+
+    /** Returns whether any word is longer than the prefix that leads to 'node'. */
+    bool hasChildren(uint32_t node) const { return (nodes[node].childMask & TRIE_LETTER_BITS) != 0; }
+
+    /** Returns the mask of letters 'node' has children for, bit 0 being 'a'. */
+    uint32_t childLetters(uint32_t node) const { return nodes[node].childMask & TRIE_LETTER_BITS; }
+
+    /** Lexicon-style lookups, walking down from the root. Case-insensitive. */
+    bool contains(const std::string& word) const;
+    bool containsPrefix(const std::string& prefix) const;
+
+    /** Number of words and nodes in the trie. */
+    int size() const { return numWords; }
+    std::size_t nodeCount() const { return numNodes; }
+
+    /** Returns the SignatureIndex of the trie's words (see boardfilter.h). It is
+     * built the first time any thread asks for it and kept as long as the trie
+     * holds the same words. Defined in boardfilter.cpp alongside the index.
+     */
+    const SignatureIndex& signatureIndex() const;
+
+private:
+    struct LazySignatureIndex {
+        std::once_flag built;
+        std::shared_ptr<const SignatureIndex> index;
+    };
+
+    uint32_t find(const std::string& prefix) const;
+    void layOut(const std::vector<std::string>& sorted);
+    void release();
+
+    std::vector<TrieNode> storage;   // owns the nodes unless they are mapped
+    void* mapping;                   // mapped image file, or nullptr
+    std::size_t mappingSize;
+    const TrieNode* nodes;           // first node, in storage or in the mapping
+    std::size_t numNodes;
+    int numWords;
+    std::unique_ptr<LazySignatureIndex> signatures;   // replaced whenever the words change
+};
+
+/**
+ * Type representing the header of a binary trie image. The node array follows
+ * immediately after it. Images are written in the byte order of the machine
+ * that compiles them; 'byteOrder' lets a reader reject an image from a machine
+ * with the other order.
+ */
+struct TrieImageHeader {
+    char magic[8];         /// TRIE_IMAGE_MAGIC
+    uint32_t byteOrder;    /// TRIE_IMAGE_BYTE_ORDER as written by the compiling machine
+    uint32_t version;      /// TRIE_IMAGE_VERSION
+    uint32_t numWords;     /// number of words in the trie
+    uint32_t reserved;     /// zero, keeps the node array 8-byte aligned
+    uint64_t numNodes;     /// number of TrieNodes following the header
+};
+
+const char TRIE_IMAGE_MAGIC[8] = {'W', 'C', 'T', 'R', 'I', 'E', '\0', '\0'};
+const uint32_t TRIE_IMAGE_BYTE_ORDER = 0x01020304;
+const uint32_t TRIE_IMAGE_VERSION = 1;
+
+/**
+ * Returns the trie for the word list at 'textPath' (such as "EnglishWords.txt").
+ * If a compiled image with the same name and a .trie extension exists and is at
+ * least as new as the word list, it is mapped with no parsing at all; otherwise
+ * the word list is parsed and the image is written for next time.
+ */
+WordTrie loadWordTrie(const std::string& textPath);
+
+/**
+ * Appends the words of the word list at 'path', one per line, to 'words'.
+ * Returns false if the file could not be read.
+ */
+bool readWordList(const std::string& path, std::vector<std::string>& words);
+
+/**
+ * Returns the path of the compiled image for the word list at 'textPath'.
+ */
+std::string trieImagePath(const std::string& textPath);
+
+/**
+ * Builds a WordTrie from any collection of strings that supports a range-based
+ * for loop, such as a Lexicon or a Vector<string>.
+ */
+template <typename WordCollection>
+WordTrie buildWordTrie(const WordCollection& words){
+    std::vector<std::string> list;
+    for (const std::string& word: words){
+        list.push_back(word);
+    }
+    return WordTrie(list);
+}
+
+/**
+ * Type representing a position in a WordTrie: the node reached by the letters
+ * consumed so far. Copying a cursor is as cheap as copying two words, and every
+ * operation on it takes constant time.
+ *
+ * Ex) TrieCursor cursor(trie);
+ *     if (cursor.advance('q') && cursor.hasChildren()) ...
+ */
+class TrieCursor {
+public:
+    explicit TrieCursor(const WordTrie& dictionary) : trie(&dictionary), node(dictionary.root()) {}
+
+    /** Moves the cursor down by 'letter'. Returns false and leaves the cursor
+     * where it was if no word continues with that letter.
+     */
+    bool advance(char letter){
+        uint32_t next = trie->child(node, letter);
+        if (next == TRIE_NO_NODE) return false;
+        node = next;
+        return true;
+    }
+
+    /** Returns whether the letters consumed so far spell a word. */
+    bool isWord() const { return trie->isWord(node); }
+
+    /** Returns whether some word continues past the letters consumed so far. */
+    bool hasChildren() const { return trie->hasChildren(node); }
+
+    /** Returns the mask of letters the cursor can advance by, bit 0 being 'a'. */
+    uint32_t childLetters() const { return trie->childLetters(node); }
+
+    /** Index of the node the cursor is on. */
+    uint32_t index() const { return node; }
+
+private:
+    const WordTrie* trie;
+    uint32_t node;
+};
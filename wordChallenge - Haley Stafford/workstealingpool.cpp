@@ -0,0 +1,221 @@
+#include "workstealingpool.h"
+#include <map>
+#include <stdexcept>
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* Whether this thread is a worker of some WorkStealingPool. */
+static thread_local bool tInPoolWorker = false;
+
+WorkStealingPool::WorkStealingPool(int numThreads) : generation(0), stopping(false), remaining(0){
+    if (numThreads < 1) numThreads = 1;
+    for (int i = 0; i < numThreads; i++){
+        workers.push_back(unique_ptr<Worker>(new Worker));
+    }
+    for (int i = 0; i < numThreads; i++){
+        threads.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    {
+        lock_guard<mutex> guard(batchLock);
+        stopping = true;
+    }
+    batchReady.notify_all();
+    for (thread& worker: threads){
+        worker.join();
+    }
+}
+
+/** The runAll() function deals the tasks out round-robin and lets the workers
+ * balance the load by stealing. Queues hold pointers into 'tasks', which stays
+ * alive until every task has finished. Called from a worker thread, it runs the
+ * tasks right there instead: queueing them would deadlock when the calling task
+ * holds the only batch of this pool, and could when it is part of a batch the
+ * other pool's workers are waiting on.
+ */
+void WorkStealingPool::runAll(const vector<Task>& tasks){
+    if (tasks.empty()) return;
+    if (tInPoolWorker){
+        exception_ptr firstFailure;
+        for (const Task& task: tasks){
+            try {
+                task(0);
+            } catch (...) {
+                if (!firstFailure) firstFailure = current_exception();
+            }
+        }
+        if (firstFailure) rethrow_exception(firstFailure);
+        return;
+    }
+    lock_guard<mutex> oneBatch(runLock);
+    remaining = int(tasks.size());
+    for (size_t i = 0; i < tasks.size(); i++){
+        Worker& worker = *workers[i % workers.size()];
+        lock_guard<mutex> guard(worker.lock);
+        worker.queue.push_back(&tasks[i]);
+    }
+    unique_lock<mutex> guard(batchLock);
+    generation++;
+    batchReady.notify_all();
+    batchDone.wait(guard, [this] { return remaining == 0; });
+    if (failure){
+        exception_ptr thrown = failure;
+        failure = nullptr;
+        rethrow_exception(thrown);
+    }
+}
+
+uint64_t WorkStealingPool::batchCount(){
+    lock_guard<mutex> guard(batchLock);
+    return generation;
+}
+
+/** The takeTask() function pops the newest task from the worker's own queue,
+ * or else the oldest task from another worker's queue. Returns nullptr if every
+ * queue is empty.
+ */
+const WorkStealingPool::Task* WorkStealingPool::takeTask(int self){
+    {
+        Worker& own = *workers[self];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.queue.empty()){
+            const Task* task = own.queue.back();
+            own.queue.pop_back();
+            return task;
+        }
+    }
+    for (size_t i = 1; i < workers.size(); i++){
+        Worker& victim = *workers[(self + i) % workers.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.queue.empty()){
+            const Task* task = victim.queue.front();
+            victim.queue.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+/** The workerLoop() function runs the tasks of each batch as it arrives. A task
+ * that throws is caught here, so the worker carries on with the batch, and the
+ * first exception is kept for runAll() to rethrow.
+ */
+void WorkStealingPool::workerLoop(int self){
+    tInPoolWorker = true;
+    uint64_t seen = 0;
+    while (true){
+        {
+            unique_lock<mutex> guard(batchLock);
+            batchReady.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        while (const Task* task = takeTask(self)){
+            try {
+                (*task)(self);
+            } catch (...) {
+                lock_guard<mutex> guard(batchLock);
+                if (!failure) failure = current_exception();
+            }
+            if (--remaining == 0){
+                lock_guard<mutex> guard(batchLock);
+                batchDone.notify_all();
+            }
+        }
+    }
+}
+
+int workerCount(int numThreads){
+    return numThreads > 0 ? numThreads : max(1, int(thread::hardware_concurrency()));
+}
+
+WorkStealingPool& sharedPool(int numThreads){
+    static mutex lock;
+    static map<int, unique_ptr<WorkStealingPool>> pools;
+
+    numThreads = workerCount(numThreads);
+    lock_guard<mutex> guard(lock);
+    unique_ptr<WorkStealingPool>& pool = pools[numThreads];
+    if (!pool) pool.reset(new WorkStealingPool(numThreads));
+    return *pool;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*                                   TEST CASES                                  */
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+STUDENT_TEST("WorkStealingPool runs every task exactly once"){
+    WorkStealingPool pool(4);
+    vector<atomic<int>> runs(1000);
+    for (atomic<int>& count: runs) count = 0;
+    vector<WorkStealingPool::Task> tasks;
+    for (size_t i = 0; i < runs.size(); i++){
+        tasks.push_back([&runs, i](int worker){
+            (void) worker;
+            runs[i]++;
+        });
+    }
+    for (int batch = 0; batch < 3; batch++){
+        pool.runAll(tasks);
+    }
+    for (atomic<int>& count: runs){
+        EXPECT_EQUAL(count.load(), 3);
+    }
+}
+
+STUDENT_TEST("WorkStealingPool lets idle workers steal queued tasks"){
+    WorkStealingPool pool(4);
+    vector<int> workerOf(64, -1);
+    vector<WorkStealingPool::Task> tasks;
+    for (size_t i = 0; i < workerOf.size(); i++){
+        tasks.push_back([&workerOf, i](int worker){
+            if (i % 4 == 0) this_thread::sleep_for(chrono::milliseconds(5)); // worker 0's tasks are slow
+            workerOf[i] = worker;
+        });
+    }
+    pool.runAll(tasks);
+    int stolen = 0;
+    for (size_t i = 0; i < workerOf.size(); i += 4){
+        EXPECT(workerOf[i] >= 0 && workerOf[i] < pool.size());
+        if (workerOf[i] != 0) stolen++;
+    }
+    EXPECT(stolen > 0);
+}
+
+STUDENT_TEST("A task can run a nested batch on the pool it runs on"){
+    WorkStealingPool& pool = sharedPool(2);
+    atomic<int> innerRuns(0);
+    vector<WorkStealingPool::Task> inner(10, [&innerRuns](int worker){
+        EXPECT_EQUAL(worker, 0);
+        innerRuns++;
+    });
+    vector<WorkStealingPool::Task> outer(4, [&pool, &inner](int){ pool.runAll(inner); });
+    pool.runAll(outer);
+    EXPECT_EQUAL(innerRuns.load(), 40);
+}
+
+STUDENT_TEST("runAll rethrows a task's exception after the rest of the batch"){
+    WorkStealingPool pool(3);
+    atomic<int> runs(0);
+    vector<WorkStealingPool::Task> tasks;
+    for (int i = 0; i < 20; i++){
+        tasks.push_back([&runs, i](int){
+            runs++;
+            if (i == 7) throw runtime_error("task 7 failed");
+        });
+    }
+    string message;
+    try {
+        pool.runAll(tasks);
+    } catch (const runtime_error& e) {
+        message = e.what();
+    }
+    EXPECT_EQUAL(message, "task 7 failed");
+    EXPECT_EQUAL(runs.load(), 20);
+    runs = 0;
+    vector<WorkStealingPool::Task> quiet(5, [&runs](int){ runs++; });
+    pool.runAll(quiet);   // the pool is still usable, and the old failure is gone
+    EXPECT_EQUAL(runs.load(), 5);
+}
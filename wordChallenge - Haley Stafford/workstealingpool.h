@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* * * * * * WORK-STEALING THREAD POOL * * * * * */
+
+/**
+ * Type representing a fixed set of worker threads that run batches of tasks.
+ * Each worker has its own queue of tasks. A worker takes tasks from the back of
+ * its own queue and, once that runs dry, steals from the front of the other
+ * workers' queues, so a worker that drew cheap tasks helps out with the rest of
+ * the batch instead of sitting idle.
+ *
+ * Ex) WorkStealingPool pool(4);
+ *     pool.runAll(tasks);   // each task is called with the index of its worker
+ */
+class WorkStealingPool {
+public:
+    /** Type of a task. The argument is the index of the worker running it,
+     * between 0 and size() - 1, so tasks can write to per-worker buffers.
+     */
+    typedef std::function<void(int)> Task;
+
+    explicit WorkStealingPool(int numThreads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /** Number of worker threads. */
+    int size() const { return int(workers.size()); }
+
+    /** Number of batches runAll() has handed to the workers so far. */
+    uint64_t batchCount();
+
+    /** Runs every task in 'tasks' on the workers and returns once all of them
+     * have finished. Batches from different callers run one after another. A
+     * task that itself calls runAll(), on this pool or any other, runs that
+     * nested batch inline on its own thread, as worker 0, rather than waiting on
+     * workers that may all be busy. If any task throws, the rest of the batch
+     * still runs, and runAll() then rethrows the first exception.
+     */
+    void runAll(const std::vector<Task>& tasks);
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<const Task*> queue;
+    };
+
+    void workerLoop(int self);
+    const Task* takeTask(int self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex runLock;                  // one batch at a time
+    std::mutex batchLock;                // guards generation and stopping
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+    uint64_t generation;                 // bumped for every batch
+    bool stopping;
+    std::atomic<int> remaining;          // tasks of the current batch not yet finished
+    std::exception_ptr failure;          // first exception a task of the current batch threw, guarded by batchLock
+};
+
+/**
+ * Returns 'numThreads', or the number of cores if 'numThreads' is 0.
+ */
+int workerCount(int numThreads);
+
+/**
+ * Returns a pool with 'numThreads' workers, or one per core if 'numThreads' is
+ * 0. Pools are created on first use and shared for the life of the program.
+ */
+WorkStealingPool& sharedPool(int numThreads);